@@ -0,0 +1,117 @@
+/**
+ * Cycle counts of the read paths on an ATmega328P.
+ * - runs on an Arduino Uno or under simavr
+ * - counts CPU cycles with Timer1 at the system clock
+ * - prints CSV: name,samples,cycles,cycles_per_sample
+ * - stops the CPU when done, which ends the simavr run
+ */
+
+#include <avr/sleep.h>
+#include <SPI.h>
+#include <Mcp320x.h>
+
+#define SPI_CS      10       // SPI slave select
+#define ADC_VREF    3300     // 3.3V Vref
+#define ADC_CLK     1600000  // SPI clock 1.6MHz
+#define SPLS        32       // samples per buffered read
+#define RUNS        8        // runs per measurement
+
+MCP3208 adc(ADC_VREF, SPI_CS);
+
+uint16_t data[SPLS];
+volatile uint16_t sink;
+
+// cycles of an empty measurement
+uint16_t overhead;
+
+/**
+ * Runs the supplied function with interrupts disabled and returns the
+ * lowest cycle count of all runs. Timer1 is 16 bit, the measured code
+ * must take less than 65536 cycles.
+ */
+template <typename Fn>
+uint16_t measure(Fn fn)
+{
+  uint16_t best = UINT16_MAX;
+  for (uint8_t r = 0; r < RUNS; r++) {
+    noInterrupts();
+    TCNT1 = 0;
+    fn();
+    uint16_t cycles = TCNT1;
+    interrupts();
+    if (cycles < best) best = cycles;
+  }
+  return best - overhead;
+}
+
+void report(const char *name, uint16_t samples, uint16_t cycles)
+{
+  Serial.print(name);
+  Serial.print(',');
+  Serial.print(samples);
+  Serial.print(',');
+  Serial.print(cycles);
+  Serial.print(',');
+  Serial.println(static_cast<float>(cycles) / samples, 1);
+}
+
+void setup() {
+
+  // configure PIN mode
+  pinMode(SPI_CS, OUTPUT);
+
+  // set initial PIN state
+  digitalWrite(SPI_CS, HIGH);
+
+  // initialize serial
+  Serial.begin(115200);
+
+  // initialize SPI interface for MCP3208
+  SPISettings settings(ADC_CLK, MSBFIRST, SPI_MODE0);
+  SPI.begin();
+  SPI.beginTransaction(settings);
+
+  // Timer1 in normal mode without prescaler
+  TCCR1A = 0;
+  TCCR1B = _BV(CS10);
+  overhead = 0;
+  overhead = measure([] {});
+
+  const auto ch = MCP3208::Channel::SINGLE_0;
+
+  Serial.println(F("name,samples,cycles,cycles_per_sample"));
+
+  report("read", 1, measure([ch] {
+    sink = adc.read(ch);
+  }));
+  report("readn", SPLS, measure([ch] {
+    adc.readn(ch, data, SPLS);
+  }));
+  report("readn_if", SPLS, measure([ch] {
+    adc.readn_if(ch, data, SPLS, [](uint16_t) { return true; });
+  }));
+  report("readn_to", SPLS, measure([ch] {
+    uint16_t sum = 0;
+    adc.readn_to(ch, [&sum](uint16_t v) { sum += v; }, SPLS);
+    sink = sum;
+  }));
+  report("scan4", SPLS, measure([] {
+    const MCP3208::Channel chs[] = {
+      MCP3208::Channel::SINGLE_0, MCP3208::Channel::SINGLE_1,
+      MCP3208::Channel::SINGLE_2, MCP3208::Channel::SINGLE_3 };
+    adc.scan(chs, data, SPLS / 4);
+  }));
+  report("toAnalog", 1, measure([] {
+    sink = adc.toAnalog(sink);
+  }));
+
+  // stop with interrupts disabled, simavr exits on this
+  Serial.flush();
+  noInterrupts();
+  set_sleep_mode(SLEEP_MODE_PWR_DOWN);
+  sleep_enable();
+  sleep_cpu();
+}
+
+void loop() {
+}
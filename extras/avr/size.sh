@@ -0,0 +1,49 @@
+#!/bin/sh
+#
+# Footprint report of the MCP320x API surface on the Uno.
+# Builds size/size.ino once per API and prints CSV with the .text, .data
+# and .bss sizes and their deltas to the SIZE_BASELINE build.
+#
+# usage: size.sh [api...]
+# Requires platformio, avr-size is taken from the platformio toolchain
+# if not in the PATH.
+
+set -e
+cd "$(dirname "$0")"
+
+PIO=${PIO:-platformio}
+BOARD=${BOARD:-uno}
+BUILD=build/size
+APIS=${*:-"READ_3201 READ_3202 READ_3204 READ_3208 READN READN_IF \
+READN_LIMITED READN_TO SCAN TO_ANALOG"}
+
+AVR_SIZE=${AVR_SIZE:-$(command -v avr-size || \
+  echo "$HOME/.platformio/packages/toolchain-atmelavr/bin/avr-size")}
+
+# prints "text data bss" of the build for the supplied API, runs in a
+# subshell, the caller has to check the exit status
+measure() {
+  rm -rf "$BUILD/$1"
+  mkdir -p "$BUILD/$1"
+  "$PIO" ci --lib=../../src --board="$BOARD" --build-dir="$BUILD/$1" \
+    --keep-build-dir --project-option="build_flags=-DSIZE_$1" \
+    size/size.ino > "$BUILD/$1.log" 2>&1 || {
+      cat "$BUILD/$1.log" >&2
+      exit 1
+    }
+  ELF=$(find "$BUILD/$1" -name firmware.elf | head -n 1)
+  SIZES=$("$AVR_SIZE" "$ELF") || exit 1
+  echo "$SIZES" | awk 'NR == 2 { print $1, $2, $3 }'
+}
+
+OUT=$(measure BASELINE) || exit 1
+set -- $OUT
+BASE_TEXT=$1 BASE_DATA=$2 BASE_BSS=$3
+
+echo "api,text,data,bss,text_delta,data_delta,bss_delta"
+echo "BASELINE,$BASE_TEXT,$BASE_DATA,$BASE_BSS,0,0,0"
+for API in $APIS; do
+  OUT=$(measure "$API") || exit 1
+  set -- $OUT
+  echo "$API,$1,$2,$3,$(($1 - BASE_TEXT)),$(($2 - BASE_DATA)),$(($3 - BASE_BSS))"
+done
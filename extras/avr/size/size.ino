@@ -0,0 +1,76 @@
+/**
+ * Minimal sketch for the footprint report of one API.
+ * - the API is selected with one of the SIZE_* defines below
+ * - SIZE_BASELINE only sets up the SPI bus and is the reference
+ * - results are kept in volatile variables to prevent dead code removal
+ */
+
+#include <SPI.h>
+#include <Mcp320x.h>
+
+#define SPI_CS      10       // SPI slave select
+#define ADC_VREF    3300     // 3.3V Vref
+#define ADC_CLK     1600000  // SPI clock 1.6MHz
+#define ADC_SPLFREQ 10000    // sample frequency 10ksps
+#define SPLS        16       // samples
+
+#if defined(SIZE_READ_3201)
+MCP3201 adc(ADC_VREF, SPI_CS);
+#define ADC_CH MCP3201::Channel::SINGLE_0
+#elif defined(SIZE_READ_3202)
+MCP3202 adc(ADC_VREF, SPI_CS);
+#define ADC_CH MCP3202::Channel::SINGLE_0
+#elif defined(SIZE_READ_3204)
+MCP3204 adc(ADC_VREF, SPI_CS);
+#define ADC_CH MCP3204::Channel::SINGLE_0
+#elif !defined(SIZE_BASELINE)
+MCP3208 adc(ADC_VREF, SPI_CS);
+#define ADC_CH MCP3208::Channel::SINGLE_0
+#endif
+
+uint16_t data[SPLS];
+volatile uint16_t sink;
+
+void setup() {
+
+  // configure PIN mode
+  pinMode(SPI_CS, OUTPUT);
+
+  // set initial PIN state
+  digitalWrite(SPI_CS, HIGH);
+
+  // initialize SPI interface
+  SPISettings settings(ADC_CLK, MSBFIRST, SPI_MODE0);
+  SPI.begin();
+  SPI.beginTransaction(settings);
+
+#if defined(SIZE_READN_LIMITED)
+  adc.calibrate(ADC_CH);
+#endif
+}
+
+void loop() {
+
+#if defined(SIZE_READ_3201) || defined(SIZE_READ_3202) || \
+    defined(SIZE_READ_3204) || defined(SIZE_READ_3208)
+  sink = adc.read(ADC_CH);
+#elif defined(SIZE_READN)
+  adc.readn(ADC_CH, data, SPLS);
+#elif defined(SIZE_READN_IF)
+  adc.readn_if(ADC_CH, data, SPLS, [](uint16_t v) { return v > 2048; });
+#elif defined(SIZE_READN_LIMITED)
+  adc.readn(ADC_CH, data, SPLS, ADC_SPLFREQ);
+#elif defined(SIZE_READN_TO)
+  uint16_t sum = 0;
+  adc.readn_to(ADC_CH, [&sum](uint16_t v) { sum += v; }, SPLS);
+  sink = sum;
+#elif defined(SIZE_SCAN)
+  const MCP3208::Channel chs[] = {
+    MCP3208::Channel::SINGLE_0, MCP3208::Channel::SINGLE_1 };
+  adc.scan(chs, data, SPLS / 2);
+#elif defined(SIZE_TO_ANALOG)
+  sink = adc.toAnalog(sink);
+#endif
+
+  sink = data[0];
+}
@@ -0,0 +1,33 @@
+/**
+ * @file Arduino.h
+ * @author Patrick Rogalla <patrick@labfruits.com>
+ *
+ * Host stand-in for the Arduino core, backed by the MCP320x host
+ * simulator. Only the functions used by the library are provided.
+ * Time is virtual and advanced by the simulated peripherals.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define LOW    0x0
+#define HIGH   0x1
+#define INPUT  0x0
+#define OUTPUT 0x1
+
+#define LSBFIRST 0
+#define MSBFIRST 1
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+
+uint32_t micros();
+uint32_t millis();
+void delay(uint32_t ms);
+void delayMicroseconds(unsigned int us);
+
+inline void interrupts() {}
+inline void noInterrupts() {}
@@ -0,0 +1,358 @@
+/**
+ * @file Mcp320xSim.cpp
+ * @author  Patrick Rogalla <patrick@labfruits.com>
+ */
+#include <stdio.h>
+#include <Arduino.h>
+#include <SPI.h>
+#include <Mcp320xClock.h>
+#include "Mcp320xSim.h"
+
+SPIClass SPI;
+
+namespace MCP320xSim {
+
+/**
+ * Defines the conversion state of the ADC.
+ */
+enum State {
+  IDLE,    /**< chip select inactive */
+  START,   /**< waiting for the start bit */
+  CONFIG,  /**< receiving the channel configuration */
+  SAMPLE,  /**< sampling */
+  NUL,     /**< null bit */
+  DATA,    /**< msb first data */
+  TAIL     /**< lsb first data (MCP3201) or zeros */
+};
+
+// VCD signal identifiers
+static const char kCs = '!';
+static const char kSclk = '"';
+static const char kMosi = '#';
+static const char kMiso = '$';
+
+static uint16_t midscale(uint8_t, uint64_t) { return 2048; }
+
+static struct {
+  uint64_t time;
+  uint32_t gpioTime;
+  uint32_t byteOverhead;
+  uint8_t csPin;
+  Chip chip;
+  Input input;
+  State state;
+  uint8_t cfg;
+  uint8_t count;
+  uint16_t value;
+  uint32_t conversions;
+  bool cs;
+  bool mock;
+  uint32_t maxClock;
+  bool pullup;
+  char miso;
+  FILE *trace;
+  uint64_t traceTime;
+} sim = { 0, 0, 0, 0xFF, CHIP_MCP3208, midscale, IDLE, 0, 0, 0, 0, true,
+  false, 0, false, 'z', nullptr, 0 };
+
+// number of configuration bits after the start bit
+static uint8_t configBits()
+{
+  switch (sim.chip) {
+    case CHIP_MCP3201: return 0;
+    case CHIP_MCP3202: return 3;
+    default: return 4;
+  }
+}
+
+// number of sampling clocks after the configuration
+static uint8_t sampleClocks()
+{
+  switch (sim.chip) {
+    case CHIP_MCP3201: return 2;
+    case CHIP_MCP3202: return 0;
+    default: return 1;
+  }
+}
+
+// channel configuration as defined by the library channel enums
+static uint8_t channel()
+{
+  switch (sim.chip) {
+    case CHIP_MCP3201: return 0;
+    case CHIP_MCP3202: return sim.cfg >> 1;
+    default: return sim.cfg;
+  }
+}
+
+// writes a signal change to the trace
+static void trace(char id, char val)
+{
+  static char level[4] = { '1', '0', '0', 'z' };
+
+  if (!sim.trace || level[id - kCs] == val) return;
+  level[id - kCs] = val;
+  if (sim.time != sim.traceTime) {
+    fprintf(sim.trace, "#%llu\n", static_cast<unsigned long long>(sim.time));
+    sim.traceTime = sim.time;
+  }
+  fprintf(sim.trace, "%c%c\n", val, id);
+}
+
+// enters the sampling state or the null bit
+static void sample(uint8_t clocks)
+{
+  sim.count = clocks;
+  sim.state = SAMPLE;
+  if (!clocks) {
+    sim.value = sim.input(channel(), sim.time) & 0x0FFF;
+    sim.conversions++;
+    sim.state = NUL;
+  }
+}
+
+// simulates one SPI clock, returns the MISO level ('0', '1', 'z')
+static char clock(bool mosi)
+{
+  char miso = 'z';
+
+  switch (sim.state) {
+    case IDLE:
+      break;
+    case START:
+      if (mosi) {
+        sim.cfg = 0;
+        sim.count = 0;
+        sim.state = CONFIG;
+        if (!configBits()) sample(sampleClocks());
+      }
+      break;
+    case CONFIG:
+      sim.cfg = (sim.cfg << 1) | mosi;
+      if (++sim.count == configBits()) sample(sampleClocks());
+      break;
+    case SAMPLE:
+      if (--sim.count == 0) sample(0);
+      break;
+    case NUL:
+      miso = '0';
+      sim.count = 12;
+      sim.state = DATA;
+      break;
+    case DATA:
+      miso = ((sim.value >> --sim.count) & 1) ? '1' : '0';
+      if (!sim.count) {
+        sim.count = 1;
+        sim.state = TAIL;
+      }
+      break;
+    case TAIL:
+      // MCP3201 repeats the data lsb first, the others output zeros
+      miso = '0';
+      if (sim.chip == CHIP_MCP3201 && sim.count < 12)
+        miso = ((sim.value >> sim.count++) & 1) ? '1' : '0';
+      break;
+  }
+
+  return miso;
+}
+
+void attach(uint8_t csPin, Chip chip)
+{
+  sim.csPin = csPin;
+  sim.chip = chip;
+  sim.state = IDLE;
+  sim.cs = true;
+  sim.time = 0;
+  sim.conversions = 0;
+}
+
+void setInput(Input input)
+{
+  sim.input = input ? input : midscale;
+}
+
+void setGpioTime(uint32_t ns)
+{
+  sim.gpioTime = ns;
+}
+
+void setByteOverhead(uint32_t ns)
+{
+  sim.byteOverhead = ns;
+}
+
+void setMaxClock(uint32_t hz)
+{
+  sim.maxClock = hz;
+}
+
+void setPullup(bool pullup)
+{
+  sim.pullup = pullup;
+}
+
+void setMock(bool mock)
+{
+  sim.mock = mock;
+}
+
+uint64_t now()
+{
+  return sim.time;
+}
+
+void advance(uint64_t ns)
+{
+  sim.time += ns;
+}
+
+uint32_t getConversions()
+{
+  return sim.conversions;
+}
+
+bool openTrace(const char *path)
+{
+  closeTrace();
+  sim.trace = fopen(path, "w");
+  if (!sim.trace) return false;
+
+  fprintf(sim.trace,
+    "$timescale 1ns $end\n"
+    "$scope module mcp320x $end\n"
+    "$var wire 1 %c cs $end\n"
+    "$var wire 1 %c sclk $end\n"
+    "$var wire 1 %c mosi $end\n"
+    "$var wire 1 %c miso $end\n"
+    "$upscope $end\n"
+    "$enddefinitions $end\n"
+    "#%llu\n"
+    "$dumpvars\n%c%c\n0%c\n0%c\nz%c\n$end\n",
+    kCs, kSclk, kMosi, kMiso, static_cast<unsigned long long>(sim.time),
+    sim.cs ? '1' : '0', kCs, kSclk, kMosi, kMiso);
+  sim.traceTime = sim.time;
+
+  return true;
+}
+
+void closeTrace()
+{
+  if (!sim.trace) return;
+  fprintf(sim.trace, "#%llu\n", static_cast<unsigned long long>(sim.time));
+  fclose(sim.trace);
+  sim.trace = nullptr;
+}
+
+}; // namespace MCP320xSim
+
+using namespace MCP320xSim;
+
+/*
+ * Arduino core stand-ins.
+ */
+
+void pinMode(uint8_t, uint8_t) {}
+
+void digitalWrite(uint8_t pin, uint8_t val)
+{
+  if (sim.mock) return;
+  sim.time += sim.gpioTime;
+  if (pin != sim.csPin) return;
+
+  bool cs = (val != LOW);
+  if (cs == sim.cs) return;
+  sim.cs = cs;
+  trace(kCs, cs ? '1' : '0');
+
+  if (cs) {
+    sim.state = IDLE;
+    trace(kMiso, 'z');
+  } else {
+    sim.state = START;
+    sim.miso = 'z';
+    // MCP3201 starts sampling with chip select
+    if (sim.chip == CHIP_MCP3201) sample(sampleClocks());
+  }
+}
+
+int digitalRead(uint8_t pin)
+{
+  return (pin == sim.csPin && sim.cs) ? HIGH : LOW;
+}
+
+uint32_t micros()
+{
+  return sim.time / 1000;
+}
+
+uint32_t millis()
+{
+  return sim.time / 1000000;
+}
+
+void delay(uint32_t ms)
+{
+  sim.time += static_cast<uint64_t>(ms) * 1000000;
+}
+
+void delayMicroseconds(unsigned int us)
+{
+  sim.time += static_cast<uint64_t>(us) * 1000;
+}
+
+#if defined(MCP320X_CLOCK_EXTERNAL)
+/*
+ * Virtual time as clock of the library. Each read costs 10ns, so busy
+ * waits on the clock terminate.
+ */
+uint32_t MCP320xClock::ticks()
+{
+  sim.time += 10;
+  return static_cast<uint32_t>(sim.time);
+}
+#endif
+
+/*
+ * SPI stand-in.
+ */
+
+void SPIClass::begin() {}
+
+void SPIClass::end() {}
+
+void SPIClass::beginTransaction(SPISettings settings)
+{
+  mSettings = settings;
+}
+
+void SPIClass::endTransaction() {}
+
+uint8_t SPIClass::transfer(uint8_t data)
+{
+  if (sim.mock) return data;
+
+  uint32_t period = 1000000000UL / mSettings.getClock();
+  bool overclocked = sim.maxClock && mSettings.getClock() > sim.maxClock;
+  uint8_t res = 0;
+
+  sim.time += sim.byteOverhead;
+  for (int8_t b = 7; b >= 0; b--) {
+    bool mosi = (data >> b) & 1;
+    // mode 0, data changes on the falling edge
+    trace(kMosi, mosi ? '1' : '0');
+    char miso = sim.cs ? 'z' : clock(mosi);
+    trace(kMiso, miso);
+    // too fast, the previous bit is still on the line
+    char level = overclocked ? sim.miso : miso;
+    sim.miso = miso;
+    res = (res << 1) | (level == '1' || (level == 'z' && sim.pullup));
+    // sampled on the rising edge
+    sim.time += period / 2;
+    trace(kSclk, '1');
+    sim.time += period - period / 2;
+    trace(kSclk, '0');
+  }
+
+  return res;
+}
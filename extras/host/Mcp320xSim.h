@@ -0,0 +1,115 @@
+/**
+ * @file Mcp320xSim.h
+ * @author Patrick Rogalla <patrick@labfruits.com>
+ *
+ * Host simulator for the MCP320x library. Provides a virtual clock,
+ * the Arduino GPIO/SPI stand-ins and a bit level model of the ADC.
+ * The SPI and chip select signals can be traced to a Value Change
+ * Dump (VCD) file for GTKWave.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+namespace MCP320xSim {
+
+/**
+ * Defines the simulated chip.
+ */
+enum Chip {
+  CHIP_MCP3201,  /**< 1 channel */
+  CHIP_MCP3202,  /**< 2 channels */
+  CHIP_MCP3204,  /**< 4 channels */
+  CHIP_MCP3208   /**< 8 channels */
+};
+
+/**
+ * Analog input model.
+ * @param [in] cfg the channel configuration bits of the conversion,
+ * as defined by the channel enums of the library.
+ * @param [in] ns the virtual time of the sampling in ns.
+ * @return the 12 bit conversion result.
+ */
+typedef uint16_t (*Input)(uint8_t cfg, uint64_t ns);
+
+/**
+ * Attaches a simulated ADC to the supplied chip select pin and
+ * resets the virtual clock.
+ * @param [in] csPin the chip select pin.
+ * @param [in] chip the chip type.
+ */
+void attach(uint8_t csPin, Chip chip);
+
+/**
+ * Sets the analog input model, by default all inputs are at midscale.
+ * @param [in] input the input function.
+ */
+void setInput(Input input);
+
+/**
+ * Sets the simulated duration of a digitalWrite call.
+ * @param [in] ns the duration in ns.
+ */
+void setGpioTime(uint32_t ns);
+
+/**
+ * Sets the simulated overhead of a SPI byte transfer, in addition
+ * to the 8 clock periods.
+ * @param [in] ns the overhead in ns.
+ */
+void setByteOverhead(uint32_t ns);
+
+/**
+ * Sets the maximum SPI clock of the chip. Above this clock the data
+ * output is too slow and the master samples the previous bit.
+ * @param [in] hz the maximum clock, 0 for no limit.
+ */
+void setMaxClock(uint32_t hz);
+
+/**
+ * Sets the level of the floating MISO line.
+ * @param [in] pullup true if a floating MISO reads high.
+ */
+void setPullup(bool pullup);
+
+/**
+ * Enables the zero latency mock mode. SPI transfers and GPIO writes
+ * return immediately without simulating the ADC, virtual time and
+ * tracing are not advanced. Used to measure the CPU cost of the
+ * library alone.
+ * @param [in] mock true to enable the mock mode.
+ */
+void setMock(bool mock);
+
+/**
+ * Returns the virtual time.
+ * @return the time in ns.
+ */
+uint64_t now();
+
+/**
+ * Advances the virtual time.
+ * @param [in] ns the time to advance in ns.
+ */
+void advance(uint64_t ns);
+
+/**
+ * Returns the number of conversions of the simulated ADC.
+ * @return the number of conversions.
+ */
+uint32_t getConversions();
+
+/**
+ * Starts tracing chip select, SCLK, MOSI and MISO to a VCD file.
+ * @param [in] path the file to write.
+ * @return true if the file was opened.
+ */
+bool openTrace(const char *path);
+
+/**
+ * Stops tracing and closes the VCD file.
+ */
+void closeTrace();
+
+}; // namespace MCP320xSim
@@ -0,0 +1,67 @@
+/**
+ * @file SPI.h
+ * @author Patrick Rogalla <patrick@labfruits.com>
+ *
+ * Host stand-in for the Arduino SPI library, backed by the MCP320x
+ * host simulator.
+ */
+#pragma once
+
+#include <Arduino.h>
+
+#define SPI_MODE0 0x00
+#define SPI_MODE1 0x04
+#define SPI_MODE2 0x08
+#define SPI_MODE3 0x0C
+
+/**
+ * SPI transaction settings.
+ */
+class SPISettings {
+
+public:
+
+  SPISettings(uint32_t clock, uint8_t bitOrder, uint8_t dataMode)
+    : mClock(clock)
+    , mBitOrder(bitOrder)
+    , mDataMode(dataMode) {}
+
+  SPISettings()
+    : SPISettings(4000000, MSBFIRST, SPI_MODE0) {}
+
+  uint32_t getClock() const { return mClock; }
+  uint8_t getBitOrder() const { return mBitOrder; }
+  uint8_t getDataMode() const { return mDataMode; }
+
+private:
+
+  uint32_t mClock;
+  uint8_t mBitOrder;
+  uint8_t mDataMode;
+};
+
+/**
+ * SPI interface, transfers are routed to the simulated device.
+ */
+class SPIClass {
+
+public:
+
+  void begin();
+  void end();
+  void beginTransaction(SPISettings settings);
+  void endTransaction();
+  uint8_t transfer(uint8_t data);
+
+  /**
+   * Returns the active settings.
+   * @return the settings of the last transaction.
+   */
+  const SPISettings &getSettings() const { return mSettings; }
+
+private:
+
+  SPISettings mSettings;
+};
+
+extern SPIClass SPI;
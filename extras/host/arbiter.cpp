@@ -0,0 +1,228 @@
+/**
+ * Sampling jitter while logging to a SD card on the same SPI bus.
+ * - simulates a MCP3208 at 2MHz and a SD card at 8MHz on one bus
+ * - samples at 10ksps and logs 2 bytes per sample in 512 byte blocks
+ * - the card is busy for 300us after each block
+ * - compares sampling without logging, logging sliced by the arbiter,
+ *   MCP320xLog::Logger written in chunks by the arbiter and blocking
+ *   block writes within the sample loop
+ * - fails if the logger drops or fails a block
+ * - prints CSV: name,samples,bytes,rate_hz,min_ns,max_ns,p99_ns,late,
+ *   max_late_ns,missed
+ */
+#include <stdio.h>
+#include <SPI.h>
+#include <Mcp320x.h>
+#include <Mcp320xArbiter.h>
+#include <Mcp320xJitter.h>
+#include <Mcp320xLogger.h>
+#include "Mcp320xSim.h"
+
+#define SPI_CS      2        // ADC slave select
+#define SD_CS       4        // SD card slave select
+#define ADC_VREF    3300     // 3.3V Vref
+#define ADC_CLK     2000000  // ADC SPI clock 2MHz
+#define SD_CLK      8000000  // SD SPI clock 8MHz
+#define SPL_FREQ    10000    // sample frequency 10ksps
+#define SPLS        20000    // samples per scenario
+#define BLOCK       512      // SD block size
+#define CHUNK       32       // bytes per chunk
+#define BUSY        300000   // card busy time after a block in ns
+
+/**
+ * SD card model, writes blocks in chunks and polls the busy state.
+ */
+class Card {
+
+public:
+
+  Card() : mSettings(SD_CLK, MSBFIRST, SPI_MODE0) { reset(); }
+
+  void reset()
+  {
+    mPos = 0;
+    mBusyUntil = 0;
+    mBytes = 0;
+  }
+
+  /**
+   * Writes the next chunk of the current block.
+   * @return false if the card is busy.
+   */
+  bool chunk(uint16_t len)
+  {
+    return write(nullptr, len);
+  }
+
+  /**
+   * Writes the supplied data as next chunk of the current block, allows
+   * the use as logger storage.
+   * @return false if the card is busy.
+   */
+  bool write(const uint8_t *data, uint16_t len)
+  {
+    begin();
+    if (busy()) {
+      end();
+      return false;
+    }
+    // write token and command on block start
+    if (!mPos) for (uint8_t i = 0; i < 8; i++) SPI.transfer(0xFF);
+    for (uint16_t i = 0; i < len; i++) SPI.transfer(data ? data[i] : 0x55);
+    mPos += len;
+    mBytes += len;
+    // crc and data response on block end, the card gets busy
+    if (mPos == BLOCK) {
+      for (uint8_t i = 0; i < 3; i++) SPI.transfer(0xFF);
+      mPos = 0;
+      mBusyUntil = MCP320xSim::now() + BUSY;
+    }
+    end();
+    return true;
+  }
+
+  /**
+   * Writes a whole block and waits until the card is ready.
+   */
+  void block()
+  {
+    while (mPos || !chunk(CHUNK)) {
+      if (mPos) chunk(CHUNK);
+    }
+    while (mBusyUntil > MCP320xSim::now()) {
+      begin();
+      busy();
+      end();
+    }
+  }
+
+  /**
+   * Polls the busy state.
+   * @return true if the card accepts the next chunk.
+   */
+  bool ready()
+  {
+    begin();
+    bool res = !busy();
+    end();
+    return res;
+  }
+
+  uint32_t getBytes() const { return mBytes; }
+
+private:
+
+  void begin()
+  {
+    SPI.beginTransaction(mSettings);
+    digitalWrite(SD_CS, LOW);
+  }
+
+  void end()
+  {
+    digitalWrite(SD_CS, HIGH);
+    SPI.endTransaction();
+  }
+
+  // polls one byte, the card holds MISO low while busy
+  bool busy()
+  {
+    SPI.transfer(0xFF);
+    return mBusyUntil > MCP320xSim::now();
+  }
+
+  SPISettings mSettings;
+  uint16_t mPos;
+  uint64_t mBusyUntil;
+  uint32_t mBytes;
+};
+
+static MCP3208 adc(ADC_VREF, SPI_CS);
+static Card card;
+static uint32_t pending;
+
+static void report(const char *name, MCP320xBus::Arbiter &arbiter,
+  const MCP320xProfile::Jitter &jitter, uint64_t ns)
+{
+  auto stats = arbiter.getStats();
+  printf("%s,%u,%u,%.1f,%u,%u,%u,%u,%u,%u\n", name, stats.slots,
+    card.getBytes(), stats.slots * 1e9 / ns, jitter.getMin(),
+    jitter.getMax(), jitter.getPercentile(99), stats.late, stats.maxLate,
+    stats.missed);
+}
+
+int main()
+{
+  MCP320xSim::attach(SPI_CS, MCP320xSim::CHIP_MCP3208);
+  MCP320xSim::setGpioTime(100);
+  MCP320xSim::setByteOverhead(200);
+
+  pinMode(SPI_CS, OUTPUT);
+  digitalWrite(SPI_CS, HIGH);
+  pinMode(SD_CS, OUTPUT);
+  digitalWrite(SD_CS, HIGH);
+
+  SPI.begin();
+  adc.setSpiSettings(SPISettings(ADC_CLK, MSBFIRST, SPI_MODE0));
+
+  const auto ch = MCP3208::Channel::SINGLE_0;
+  MCP320xBus::Arbiter arbiter(SPL_FREQ);
+  MCP320xProfile::Jitter jitter(1000);
+  arbiter.setJitter(&jitter);
+
+  printf("name,samples,bytes,rate_hz,min_ns,max_ns,p99_ns,late,"
+    "max_late_ns,missed\n");
+
+  // sampling only
+  card.reset();
+  uint64_t t = MCP320xSim::now();
+  arbiter.run(SPLS, [&] { adc.read(ch); }, [] { return false; });
+  report("idle", arbiter, jitter, MCP320xSim::now() - t);
+
+  // chunks in the slack between samples
+  card.reset();
+  pending = 0;
+  t = MCP320xSim::now();
+  arbiter.run(SPLS, [&] {
+    adc.read(ch);
+    pending += 2;
+  }, [] {
+    if (pending < CHUNK || !card.chunk(CHUNK)) return false;
+    pending -= CHUNK;
+    return true;
+  });
+  report("arbiter", arbiter, jitter, MCP320xSim::now() - t);
+
+  // logger blocks in chunks in the slack between samples
+  card.reset();
+  MCP320xLog::Logger<Card, BLOCK> logger(card);
+  t = MCP320xSim::now();
+  arbiter.run(SPLS, [&] {
+    logger.add(adc.read(ch));
+  }, [&] {
+    return card.ready() && logger.poll(CHUNK);
+  });
+  report("logger", arbiter, jitter, MCP320xSim::now() - t);
+  auto stats = logger.getStats();
+  bool ok = !stats.overruns && !stats.errors;
+
+  // whole blocks within the sample loop
+  card.reset();
+  pending = 0;
+  t = MCP320xSim::now();
+  arbiter.run(SPLS, [&] {
+    adc.read(ch);
+    pending += 2;
+    if (pending >= BLOCK) {
+      card.block();
+      pending -= BLOCK;
+    }
+  }, [] { return false; });
+  report("blocking", arbiter, jitter, MCP320xSim::now() - t);
+
+  if (!ok) {
+    fprintf(stderr, "logger: %u overruns, %u errors\n", stats.overruns,
+      stats.errors);
+  }
+  return ok ? 0 : 1;
+}
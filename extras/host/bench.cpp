@@ -0,0 +1,197 @@
+/**
+ * Microbenchmarks of the acquisition hot path on the host.
+ * - runs against the zero latency mock SPI of the host simulator
+ * - measures the CPU cost per sample of the read paths and DSP stages
+ * - prints CSV: name,samples,best_ns,median_ns (ns per sample)
+ * usage: bench [filter]
+ */
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <chrono>
+#include <SPI.h>
+#include <Mcp320x.h>
+#include <Mcp320xSdt.h>
+#include <Mcp320xStats.h>
+#include <Mcp320xQuantile.h>
+#include <Mcp320xFft.h>
+#include <Mcp320xGoertzel.h>
+#include <Mcp320xMeter.h>
+#include <Mcp320xDeskew.h>
+#include <Mcp320xZeroCross.h>
+#include <Mcp320xEnvelope.h>
+#include <Mcp320xLockIn.h>
+#include "Mcp320xSim.h"
+
+#define SPI_CS      2        // SPI slave select
+#define ADC_VREF    3300     // 3.3V Vref
+#define ADC_CLK     1600000  // SPI clock 1.6MHz
+#define SPLS        1024     // samples per run
+#define RUNS        15       // runs per benchmark
+#define MIN_TIME    2000000  // minimum time per run in ns
+
+using Clock = std::chrono::steady_clock;
+
+static const char *filter = nullptr;
+static volatile uint32_t sink;
+static uint16_t input[SPLS];
+
+/**
+ * Runs the supplied function repeatedly and prints the cost per sample.
+ * Each run repeats the function until MIN_TIME has elapsed, the best
+ * and the median of all runs are reported.
+ * @param [in] name the benchmark name.
+ * @param [in] samples number of samples processed per call.
+ * @param [in] fn the function to measure.
+ */
+template <typename Fn>
+static void bench(const char *name, uint32_t samples, Fn &&fn)
+{
+  if (filter && !strstr(name, filter)) return;
+
+  // warm up and find the number of calls per run
+  uint32_t calls = 1;
+  for (;;) {
+    auto start = Clock::now();
+    for (uint32_t i = 0; i < calls; i++) fn();
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      Clock::now() - start).count();
+    if (ns >= MIN_TIME) break;
+    calls *= 2;
+  }
+
+  double res[RUNS];
+  for (uint8_t r = 0; r < RUNS; r++) {
+    auto start = Clock::now();
+    for (uint32_t i = 0; i < calls; i++) fn();
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      Clock::now() - start).count();
+    res[r] = static_cast<double>(ns) / (static_cast<double>(calls) * samples);
+  }
+
+  std::sort(res, res + RUNS);
+  printf("%s,%u,%.2f,%.2f\n", name, samples, res[0], res[RUNS / 2]);
+  fflush(stdout);
+}
+
+int main(int argc, char **argv)
+{
+  if (argc > 1) filter = argv[1];
+
+  MCP320xSim::attach(SPI_CS, MCP320xSim::CHIP_MCP3208);
+  MCP320xSim::setMock(true);
+
+  // 50Hz sine sampled at 10ksps, about 2.5 cycles per buffer
+  for (uint16_t i = 0; i < SPLS; i++)
+    input[i] = 2048 + 2000 * sin(2 * M_PI * 50 * i / 10000.0);
+
+  MCP3208 adc(ADC_VREF, SPI_CS);
+  pinMode(SPI_CS, OUTPUT);
+  digitalWrite(SPI_CS, HIGH);
+
+  SPISettings settings(ADC_CLK, MSBFIRST, SPI_MODE0);
+  SPI.begin();
+  SPI.beginTransaction(settings);
+
+  const auto ch = MCP3208::Channel::SINGLE_0;
+  adc.calibrate(ch);
+
+  static uint16_t data[SPLS];
+  static int16_t re[SPLS], im[SPLS];
+
+  printf("name,samples,best_ns,median_ns\n");
+
+  // read paths
+  bench("read", 1, [&] {
+    sink = adc.read(ch);
+  });
+  bench("readn", SPLS, [&] {
+    adc.readn(ch, data, SPLS);
+    sink = data[0];
+  });
+  bench("readn_if", SPLS, [&] {
+    adc.readn_if(ch, data, SPLS, [](uint16_t) { return true; });
+    sink = data[0];
+  });
+  bench("readn_limited", SPLS, [&] {
+    // delayMicroseconds only advances the virtual clock
+    adc.readn(ch, data, SPLS, 10000);
+    sink = data[0];
+  });
+  bench("readn_to", SPLS, [&] {
+    uint32_t sum = 0;
+    adc.readn_to(ch, [&sum](uint16_t v) { sum += v; }, SPLS);
+    sink = sum;
+  });
+  bench("scan4", SPLS, [&] {
+    const MCP3208::Channel chs[] = {
+      MCP3208::Channel::SINGLE_0, MCP3208::Channel::SINGLE_1,
+      MCP3208::Channel::SINGLE_2, MCP3208::Channel::SINGLE_3 };
+    adc.scan(chs, data, SPLS / 4);
+    sink = data[0];
+  });
+  MCP3208 managed(ADC_VREF, SPI_CS);
+  managed.setSpiSettings(settings);
+  bench("read_managed", 1, [&] {
+    sink = managed.read(ch);
+  });
+  bench("readn_managed", SPLS, [&] {
+    managed.readn(ch, data, SPLS);
+    sink = data[0];
+  });
+  bench("toAnalog", SPLS, [&] {
+    uint32_t sum = 0;
+    for (uint16_t i = 0; i < SPLS; i++) sum += adc.toAnalog(input[i]);
+    sink = sum;
+  });
+
+  // dsp stages
+  MCP320xDsp::Sdt sdt(4);
+  bench("sdt", SPLS, [&] {
+    for (uint16_t i = 0; i < SPLS; i++) sink = sdt.add(input[i]);
+  });
+  MCP320xDsp::Stats stats;
+  bench("stats", SPLS, [&] {
+    stats.add(input, SPLS);
+    sink = stats.snapshot().count;
+  });
+  MCP320xDsp::Quantile quantile(0.5f);
+  bench("quantile", SPLS, [&] {
+    quantile.add(input, SPLS);
+    sink = quantile.value();
+  });
+  MCP320xDsp::Fft fft(SPLS);
+  bench("fft_spectrum", SPLS, [&] {
+    for (uint16_t i = 0; i < SPLS; i++) re[i] = input[i] - 2048;
+    sink = fft.spectrum(re, im).bin;
+  });
+  const uint32_t tones[] = { 50, 150, 250, 350 };
+  MCP320xDsp::Goertzel<4> goertzel(tones, 10000, 200);
+  bench("goertzel4", SPLS, [&] {
+    for (uint16_t i = 0; i < SPLS; i++) sink = goertzel.add(input[i]);
+  });
+  MCP320xDsp::Meter meter(0, 1, 25000, 50000);
+  bench("meter", SPLS / 2, [&] {
+    for (uint16_t i = 0; i < SPLS; i += 2) sink = meter.add(input + i);
+  });
+  MCP320xDsp::Deskew<4> deskew(25000);
+  bench("deskew4", SPLS / 4, [&] {
+    for (uint16_t i = 0; i < SPLS; i += 4) sink = deskew.add(input + i)[0];
+  });
+  MCP320xDsp::ZeroCross zeroCross(10000);
+  bench("zerocross", SPLS, [&] {
+    for (uint16_t i = 0; i < SPLS; i++) sink = zeroCross.add(input[i]);
+  });
+  MCP320xDsp::Envelope envelope(0, 8, 64, 1000);
+  bench("envelope", SPLS, [&] {
+    for (uint16_t i = 0; i < SPLS; i++) sink = envelope.add(input[i]);
+  });
+  MCP320xDsp::LockIn lockIn(3, 200, 5);
+  lockIn.reset();
+  bench("lockin", SPLS, [&] {
+    for (uint16_t i = 0; i < SPLS; i++) sink = lockIn.add(input[i]);
+  });
+
+  return 0;
+}
@@ -0,0 +1,129 @@
+/**
+ * Double buffered logging of MCP3208 samples to a host file.
+ * - samples at 10ksps in a simulated timer interrupt
+ * - writes 512 byte blocks from the main loop
+ * - the storage needs the configured latency per block, during which
+ *   the sampling interrupt keeps running
+ * - prints CSV: latency_us,blocks,overruns,late,max_latency_ns,min_fill_ns
+ * usage: logger <file.bin>
+ */
+#include <stdio.h>
+#include <math.h>
+#include <SPI.h>
+#include <Mcp320x.h>
+#include <Mcp320xLogger.h>
+#include "Mcp320xSim.h"
+
+#define SPI_CS      2        // SPI slave select
+#define ADC_VREF    3300     // 3.3V Vref
+#define ADC_CLK     1600000  // SPI clock 1.6MHz
+#define SPL_FREQ    10000    // sample frequency 10ksps
+#define SPLS        51200    // samples per run, 200 blocks
+#define STEP        10       // simulation step in us
+
+/**
+ * Host file storage with a simulated write latency.
+ */
+class HostStorage {
+
+public:
+
+  HostStorage(FILE *file, void (*isr)())
+    : mFile(file)
+    , mIsr(isr)
+    , mLatency(0) {}
+
+  void setLatency(uint32_t us) { mLatency = us; }
+
+  bool write(const uint8_t *data, uint16_t len)
+  {
+    // the sampling interrupt preempts the write
+    for (uint32_t t = 0; t < mLatency; t += STEP) {
+      delayMicroseconds(STEP);
+      mIsr();
+    }
+    return fwrite(data, 1, len, mFile) == len;
+  }
+
+private:
+
+  FILE *mFile;
+  void (*mIsr)();
+  uint32_t mLatency;
+};
+
+// 50Hz sine on all channels
+static uint16_t sine(uint8_t, uint64_t ns)
+{
+  return 2048 + 2000 * sin(2 * M_PI * 50 * ns / 1e9);
+}
+
+static MCP3208 adc(ADC_VREF, SPI_CS);
+static HostStorage *storage;
+static MCP320xLog::Logger<HostStorage> *logger;
+static uint64_t next;
+static uint32_t samples;
+
+// timer interrupt, takes all samples due until now
+static void isr()
+{
+  while (samples < SPLS && MCP320xSim::now() >= next) {
+    logger->add(adc.read(MCP3208::Channel::SINGLE_0));
+    samples++;
+    next += 1000000000ULL / SPL_FREQ;
+  }
+}
+
+int main(int argc, char **argv)
+{
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s <file.bin>\n", argv[0]);
+    return 1;
+  }
+
+  FILE *file = fopen(argv[1], "wb");
+  if (!file) {
+    fprintf(stderr, "cannot open %s\n", argv[1]);
+    return 1;
+  }
+
+  MCP320xSim::attach(SPI_CS, MCP320xSim::CHIP_MCP3208);
+  MCP320xSim::setInput(sine);
+
+  pinMode(SPI_CS, OUTPUT);
+  digitalWrite(SPI_CS, HIGH);
+
+  SPISettings settings(ADC_CLK, MSBFIRST, SPI_MODE0);
+  SPI.begin();
+  SPI.beginTransaction(settings);
+
+  HostStorage host(file, isr);
+  MCP320xLog::Logger<HostStorage> log(host);
+  storage = &host;
+  logger = &log;
+
+  printf("latency_us,blocks,overruns,late,max_latency_ns,min_fill_ns\n");
+
+  // a block fills in 25.6ms
+  const uint32_t latencies[] = { 1000, 10000, 20000, 30000, 60000 };
+  for (uint32_t latency : latencies) {
+    storage->setLatency(latency);
+    logger->reset();
+    samples = 0;
+    next = MCP320xSim::now();
+
+    // main loop
+    while (samples < SPLS) {
+      isr();
+      if (!logger->poll()) delayMicroseconds(STEP);
+    }
+    logger->flush();
+
+    auto stats = logger->getStats();
+    printf("%u,%u,%u,%u,%u,%u\n", latency, stats.blocks, stats.overruns,
+      stats.late, stats.maxLatency, stats.minFill);
+  }
+
+  fclose(file);
+  return 0;
+}
@@ -0,0 +1,141 @@
+/**
+ * Accuracy of the P² quantile estimator against exact quantiles.
+ * - normal distributed samples N(2048, 200), up to 2^25 samples
+ * - a 50Hz sine read from the simulated MCP3208 with readn_to
+ * - exact quantiles from a histogram of all 4096 codes
+ * - prints CSV: signal,p,samples,estimate,exact,error
+ * - fails if an error exceeds the tolerance of 1% of the range
+ *   between the 1st and the 99th percentile
+ */
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <SPI.h>
+#include <Mcp320x.h>
+#include <Mcp320xQuantile.h>
+#include "Mcp320xSim.h"
+
+#define SPI_CS      2        // SPI slave select
+#define ADC_VREF    3300     // 3.3V Vref
+#define ADC_CLK     1600000  // SPI clock 1.6MHz
+
+static const float kP[] = { 0.01f, 0.5f, 0.9f, 0.99f };
+static const uint8_t kNum = sizeof(kP) / sizeof(kP[0]);
+
+/**
+ * Exact quantiles of 12 bit samples.
+ */
+class Histogram {
+
+public:
+
+  Histogram() { memset(mBins, 0, sizeof(mBins)); mCount = 0; }
+
+  void add(uint16_t value) { mBins[value]++; mCount++; }
+
+  // smallest code with at least p of all samples below or equal
+  uint16_t quantile(float p) const
+  {
+    uint64_t rank = ceil(p * mCount);
+    uint64_t sum = 0;
+    for (uint16_t i = 0; i < 4096; i++) {
+      sum += mBins[i];
+      if (sum >= rank) return i;
+    }
+    return 4095;
+  }
+
+private:
+
+  uint64_t mBins[4096];
+  uint64_t mCount;
+};
+
+// xorshift generator, reproducible on all hosts
+static uint32_t rnd()
+{
+  static uint32_t x = 2463534242UL;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  return x;
+}
+
+static uint16_t normal()
+{
+  static bool odd = false;
+  static float next;
+  if ((odd = !odd)) {
+    float u1 = (rnd() + 1.0f) / 4294967296.0f;
+    float u2 = rnd() / 4294967296.0f;
+    float r = sqrtf(-2 * logf(u1));
+    next = r * sinf(6.2831853f * u2);
+    return lroundf(2048 + 200 * r * cosf(6.2831853f * u2));
+  }
+  return lroundf(2048 + 200 * next);
+}
+
+// 50Hz sine on all channels
+static uint16_t sine(uint8_t, uint64_t ns)
+{
+  return 2048 + 2000 * sin(2 * M_PI * 50 * ns / 1e9);
+}
+
+static bool report(const char *signal, MCP320xDsp::Quantile *q,
+  const Histogram &hist, uint32_t samples)
+{
+  bool ok = true;
+  float tolerance = 0.01f * (hist.quantile(0.99f) - hist.quantile(0.01f));
+  for (uint8_t i = 0; i < kNum; i++) {
+    uint16_t exact = hist.quantile(kP[i]);
+    float error = q[i].value() - exact;
+    printf("%s,%.2f,%u,%.1f,%u,%.1f\n", signal, kP[i], samples, q[i].value(),
+      exact, error);
+    if (fabsf(error) > tolerance) ok = false;
+  }
+  return ok;
+}
+
+int main()
+{
+  bool ok = true;
+  MCP320xDsp::Quantile q[kNum] = {
+    MCP320xDsp::Quantile(kP[0]), MCP320xDsp::Quantile(kP[1]),
+    MCP320xDsp::Quantile(kP[2]), MCP320xDsp::Quantile(kP[3]) };
+  Histogram hist;
+
+  printf("signal,p,samples,estimate,exact,error\n");
+
+  uint32_t n = 0;
+  for (uint32_t report_at = 1UL << 16; report_at <= 1UL << 25;
+       report_at <<= 1) {
+    for (; n < report_at; n++) {
+      uint16_t v = normal();
+      hist.add(v);
+      for (uint8_t i = 0; i < kNum; i++) q[i].add(v);
+    }
+    ok &= report("normal", q, hist, n);
+  }
+
+  // sampled by the library on the simulator
+  MCP320xSim::attach(SPI_CS, MCP320xSim::CHIP_MCP3208);
+  MCP320xSim::setInput(sine);
+
+  MCP3208 adc(ADC_VREF, SPI_CS);
+  SPI.begin();
+  SPI.beginTransaction(SPISettings(ADC_CLK, MSBFIRST, SPI_MODE0));
+
+  Histogram sineHist;
+  for (uint8_t i = 0; i < kNum; i++) q[i].reset();
+  const uint32_t samples = 1UL << 18;
+  for (uint32_t s = 0; s < samples; s += 1024) {
+    adc.readn_to(MCP3208::Channel::SINGLE_0, [&](uint16_t v) {
+      sineHist.add(v);
+      for (uint8_t i = 0; i < kNum; i++) q[i].add(v);
+    }, 1024);
+  }
+  ok &= report("sine", q, sineHist, samples);
+
+  if (!ok) fprintf(stderr, "quantile error above tolerance\n");
+  return ok ? 0 : 1;
+}
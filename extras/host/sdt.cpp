@@ -0,0 +1,147 @@
+/**
+ * Error bound of the swinging door trending compression.
+ * - compresses synthetic signals and a signal sampled from the simulated
+ *   MCP3208 with several deviation limits
+ * - optionally compresses recorded files of native 16 bit samples, e.g.
+ *   logger.bin of the logger tool
+ * - reconstructs every sample by linear interpolation between the
+ *   emitted endpoints and checks it against the configured deviation
+ *   plus 1 LSB of endpoint rounding
+ * - prints CSV: signal,max_dev,samples,points,max_error
+ * - fails if a reconstructed sample exceeds the bound
+ * usage: sdt [file.bin ...]
+ */
+#include <stdio.h>
+#include <math.h>
+#include <vector>
+#include <SPI.h>
+#include <Mcp320x.h>
+#include <Mcp320xSdt.h>
+#include "Mcp320xSim.h"
+
+#define SPI_CS      2        // SPI slave select
+#define ADC_VREF    3300     // 3.3V Vref
+#define ADC_CLK     1600000  // SPI clock 1.6MHz
+#define SPLS        100000   // samples per synthetic signal
+
+static const uint16_t kDevs[] = { 0, 1, 4, 16, 64 };
+
+// xorshift generator, reproducible on all hosts
+static uint32_t rnd()
+{
+  static uint32_t x = 2463534242UL;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  return x;
+}
+
+static uint16_t clip(double v)
+{
+  return (v < 0) ? 0 : (v > 4095) ? 4095 : lround(v);
+}
+
+// 50Hz sine with noise on all channels
+static uint16_t noisySine(uint8_t, uint64_t ns)
+{
+  return clip(2048 + 2000 * sin(2 * M_PI * 50 * ns / 1e9) +
+    static_cast<int32_t>(rnd() % 17) - 8);
+}
+
+/**
+ * Compresses the samples and checks the reconstruction.
+ * @return true if all samples are within the deviation.
+ */
+static bool check(const char *signal, const std::vector<uint16_t> &data)
+{
+  bool ok = true;
+  for (uint16_t dev : kDevs) {
+    MCP320xDsp::Sdt sdt(dev);
+    std::vector<MCP320xDsp::Sdt::Point> points;
+    for (uint16_t v : data)
+      if (sdt.add(v)) points.push_back(sdt.point());
+    if (sdt.flush()) points.push_back(sdt.point());
+
+    // the first and the last sample are always endpoints
+    double maxErr = 0;
+    if (points.empty() || points.front().index != 0 ||
+        points.back().index != data.size() - 1) {
+      maxErr = INFINITY;
+    } else {
+      for (size_t k = 1; k < points.size(); k++) {
+        const MCP320xDsp::Sdt::Point &a = points[k - 1], &b = points[k];
+        for (uint32_t i = a.index; i <= b.index; i++) {
+          double v = a.value + (static_cast<double>(b.value) - a.value) *
+            (i - a.index) / (b.index - a.index);
+          double err = fabs(v - data[i]);
+          if (err > maxErr) maxErr = err;
+        }
+      }
+    }
+
+    printf("%s,%u,%zu,%zu,%.3f\n", signal, dev, data.size(), points.size(),
+      maxErr);
+    // the endpoints are rounded to integers by up to 1 LSB
+    if (!(maxErr < dev + 1)) ok = false;
+  }
+  return ok;
+}
+
+int main(int argc, char **argv)
+{
+  bool ok = true;
+  std::vector<uint16_t> data(SPLS);
+
+  printf("signal,max_dev,samples,points,max_error\n");
+
+  for (uint32_t i = 0; i < SPLS; i++) data[i] = 1234;
+  ok &= check("constant", data);
+
+  for (uint32_t i = 0; i < SPLS; i++) data[i] = i % 4096;
+  ok &= check("ramp", data);
+
+  for (uint32_t i = 0; i < SPLS; i++)
+    data[i] = clip(2048 + 2100 * sin(2 * M_PI * i / 2000.0));
+  ok &= check("clipped_sine", data);
+
+  for (uint32_t i = 0; i < SPLS; i++) data[i] = ((i / 500) & 1) ? 4095 : 0;
+  ok &= check("square", data);
+
+  int32_t walk = 2048;
+  for (uint32_t i = 0; i < SPLS; i++) {
+    walk += static_cast<int32_t>(rnd() % 9) - 4;
+    data[i] = walk = clip(walk);
+  }
+  ok &= check("random_walk", data);
+
+  for (uint32_t i = 0; i < SPLS; i++) data[i] = rnd() % 4096;
+  ok &= check("noise", data);
+
+  // sampled by the library on the simulator
+  MCP320xSim::attach(SPI_CS, MCP320xSim::CHIP_MCP3208);
+  MCP320xSim::setInput(noisySine);
+
+  MCP3208 adc(ADC_VREF, SPI_CS);
+  SPI.begin();
+  SPI.beginTransaction(SPISettings(ADC_CLK, MSBFIRST, SPI_MODE0));
+  for (uint32_t i = 0; i < SPLS; i += 1000)
+    adc.readn(MCP3208::Channel::SINGLE_0, &data[i], 1000);
+  ok &= check("sampled_sine", data);
+
+  // recorded files
+  for (int a = 1; a < argc; a++) {
+    FILE *file = fopen(argv[a], "rb");
+    if (!file) {
+      fprintf(stderr, "cannot open %s\n", argv[a]);
+      return 1;
+    }
+    std::vector<uint16_t> rec;
+    uint16_t v;
+    while (fread(&v, sizeof(v), 1, file) == 1) rec.push_back(v);
+    fclose(file);
+    if (!rec.empty()) ok &= check(argv[a], rec);
+  }
+
+  if (!ok) fprintf(stderr, "sdt error above the deviation\n");
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,59 @@
+/**
+ * Writes a VCD trace of MCP3208 reads on the host simulator.
+ * - simulates a MCP3208 on a 1.6MHz SPI bus
+ * - traces a single read and a buffered read
+ * usage: trace <file.vcd>
+ */
+#include <stdio.h>
+#include <math.h>
+#include <SPI.h>
+#include <Mcp320x.h>
+#include "Mcp320xSim.h"
+
+#define SPI_CS      2        // SPI slave select
+#define ADC_VREF    3300     // 3.3V Vref
+#define ADC_CLK     1600000  // SPI clock 1.6MHz
+#define SPLS        4        // samples
+
+// 1kHz sine on all channels
+static uint16_t sine(uint8_t, uint64_t ns)
+{
+  return 2048 + 2000 * sin(2 * M_PI * 1000 * ns / 1e9);
+}
+
+int main(int argc, char **argv)
+{
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s <file.vcd>\n", argv[0]);
+    return 1;
+  }
+
+  MCP320xSim::attach(SPI_CS, MCP320xSim::CHIP_MCP3208);
+  MCP320xSim::setInput(sine);
+
+  MCP3208 adc(ADC_VREF, SPI_CS);
+  pinMode(SPI_CS, OUTPUT);
+  digitalWrite(SPI_CS, HIGH);
+
+  SPISettings settings(ADC_CLK, MSBFIRST, SPI_MODE0);
+  SPI.begin();
+  SPI.beginTransaction(settings);
+
+  if (!MCP320xSim::openTrace(argv[1])) {
+    fprintf(stderr, "cannot open %s\n", argv[1]);
+    return 1;
+  }
+
+  uint16_t raw = adc.read(MCP3208::Channel::SINGLE_0);
+  uint16_t data[SPLS];
+  adc.read(MCP3208::Channel::SINGLE_1, data);
+
+  MCP320xSim::closeTrace();
+
+  printf("value: %u\n", raw);
+  for (uint16_t i = 0; i < SPLS; i++) printf("data[%u]: %u\n", i, data[i]);
+  printf("virtual time: %llu ns\n",
+    static_cast<unsigned long long>(MCP320xSim::now()));
+
+  return 0;
+}
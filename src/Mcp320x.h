@@ -11,6 +11,15 @@
 #include <stdbool.h>
 #include <Arduino.h>
 #include <SPI.h>
+#include "Mcp320xClock.h"
+#include "Mcp320xHooks.h"
+#include "Mcp320xCalibration.h"
+#include "Mcp320xPhases.h"
+
+namespace MCP320xProfile {
+  class Jitter;
+  class Counters;
+};
 
 namespace MCP320xTypes {
 
@@ -111,7 +120,12 @@ namespace MCP3208 {
 
 }; // namespace MCP320xTypes
 
-template <typename ChannelType>
+/**
+ * MCP320x interface.
+ * @tparam ChannelType the channel configuration of the chip.
+ * @tparam Hooks trace hook policy, see MCP320xHooks::None.
+ */
+template <typename ChannelType, typename Hooks = MCP320xHooks::None>
 class MCP320x {
 
 public:
@@ -124,6 +138,14 @@ public:
   /** ADC Channel configuration. */
   using Channel = ChannelType;
 
+  /**
+   * Defines the handling of invalid frames by validated reads.
+   */
+  enum FramePolicy {
+    COUNT,     /**< reads all samples and counts the invalid frames */
+    FAIL_FAST  /**< stops at the first invalid frame */
+  };
+
   /**
    * Initiates a MCP320x object. The chip select pin must be already
    * configured as output.
@@ -152,6 +174,58 @@ public:
    */
   void calibrate(Channel ch);
 
+  /**
+   * Exports the current calibration as profile keyed by the supplied
+   * SPI clock and board identifier, and the calibration channel.
+   * @param [in] spiClock the SPI clock in hz.
+   * @param [in] boardId user defined board identifier.
+   * @param [out] cal the sealed calibration profile.
+   * @return true if calibrated and the profile was exported.
+   */
+  bool getCalibration(uint32_t spiClock, uint32_t boardId,
+    MCP320xTypes::Calibration &cal) const;
+
+  /**
+   * Imports a calibration profile. The profile is accepted if it is
+   * intact, matches the supplied key and a short speed test of 16 reads
+   * agrees with the stored sampling time within 1/8. Otherwise the
+   * current calibration is kept. The SPI interface must be initialized
+   * and put in a usable state before calling this function.
+   * @param [in] ch the channel used for calibration.
+   * @param [in] spiClock the SPI clock in hz.
+   * @param [in] boardId user defined board identifier.
+   * @param [in] cal the calibration profile to import.
+   * @return true if the profile was accepted.
+   */
+  bool setCalibration(Channel ch, uint32_t spiClock, uint32_t boardId,
+    const MCP320xTypes::Calibration &cal);
+
+  /**
+   * Finds the fastest reliable SPI clock. The clock is stepped up by 1/4
+   * from the minimum clock, which is the slow baseline. Each step checks
+   * the null bit of 32 frames of the supplied channel and 32 reads of the
+   * reference channel, which must be connected to a stable voltage. The
+   * reference reads must not spread more than the tolerance and their mean
+   * must agree with the baseline within the tolerance. The first failing
+   * step ends the search. Every step runs in its own transaction, an
+   * active managed transaction is restarted with the new settings.
+   * Without managed settings no transaction may be active during the
+   * call and the application must use the found clock for its following
+   * transactions. Managed settings are replaced by ones with the found
+   * clock in mode 0. The timing is calibrated with the found clock.
+   * Clocks are reported as the SPI hardware applies them, e.g. rounded
+   * down to F_CPU/2^k on AVR.
+   * @param [in] ch the channel to calibrate and to check the frames.
+   * @param [in] ref the reference channel.
+   * @param [in] minClock the baseline SPI clock in hz.
+   * @param [in] maxClock the maximum SPI clock in hz.
+   * @param [in] tolerance the tolerance of the reference in LSB.
+   * @return the found effective SPI clock in hz, 0 if the baseline
+   * failed. The baseline clock is kept uncalibrated in this case.
+   */
+  uint32_t autotune(Channel ch, Channel ref, uint32_t minClock,
+    uint32_t maxClock, uint16_t tolerance = 4);
+
   /**
    * Reads the supplied channel. The SPI interface must be initialized and
    * put in a usable state before calling this function.
@@ -220,6 +294,55 @@ public:
     readn_if(ch, data, N, splFreq, p);
   }
 
+  /**
+   * Reads the supplied channel and validates the response frame. The
+   * null bit must be low and the MCP3201 must repeat bit 1 lsb first.
+   * This detects a floating MISO line with pull-up, a line stuck high
+   * and shifted data of a too fast clock without extra transfers. A line
+   * stuck low is not detected. Invalid frames are counted by the
+   * attached counters. The SPI interface must be initialized and put in
+   * a usable state before calling this function.
+   * @param [in] ch defines the channel to read from.
+   * @param [out] value the converted raw value, also set if invalid.
+   * @return true if the frame was valid.
+   */
+  bool read_checked(Channel ch, uint16_t &value) const;
+
+  /**
+   * Reads the supplied channel, validates the response frames and
+   * stores the data in the supplied data array. See read_checked.
+   * @param [in] ch defines the channel to read from.
+   * @param [out] data array to store the values.
+   * @param [in] policy the handling of invalid frames.
+   * @return the number of valid frames. With FAIL_FAST all values
+   * before the returned index are valid.
+   */
+  template <typename T, size_t N>
+  uint16_t read_checked(Channel ch, T (&data)[N],
+    FramePolicy policy = FAIL_FAST) const
+  {
+    return readn_checked(ch, data, N, policy);
+  }
+
+  /**
+   * Reads the supplied channel, validates the response frames and
+   * stores N values in the supplied data array. See read_checked.
+   * @param [in] ch defines the channel to read from.
+   * @param [out] data array to store the values.
+   * @param [in] num number of reads. The data array needs to be
+   * at least that size.
+   * @param [in] policy the handling of invalid frames.
+   * @return the number of valid frames. With FAIL_FAST all values
+   * before the returned index are valid.
+   */
+  template <typename T>
+  uint16_t readn_checked(Channel ch, T *data, uint16_t num,
+    FramePolicy policy = FAIL_FAST) const
+  {
+    Transaction tr(this);
+    return executeChecked(createCmd(ch), data, num, policy);
+  }
+
   /**
    * Reads the supplied channel and stores N values in the supplied
    * data array. The SPI interface must be initialized and put in a
@@ -232,6 +355,7 @@ public:
   template <typename T>
   void readn(Channel ch, T *data, uint16_t num) const
   {
+    Transaction tr(this);
     execute(createCmd(ch), data, num);
   }
 
@@ -250,6 +374,7 @@ public:
   template <typename T>
   void readn(Channel ch, T *data, uint16_t num, uint32_t splFreq)
   {
+    Transaction tr(this);
     execute(createCmd(ch), data, num, getSplDelay(ch, splFreq));
   }
 
@@ -268,8 +393,12 @@ public:
   template <typename T, typename Predicate>
   void readn_if(Channel ch, T *data, uint16_t num, Predicate p) const
   {
+    Transaction tr(this);
     auto cmd = createCmd(ch);
-    while (!p(execute(cmd))) {}
+    Timing t(this);
+    while (!p(execute(cmd))) t.lap();
+    endTrigger(t);
+    Hooks::onTriggerArmed();
     execute(cmd, data, num);
   }
 
@@ -291,11 +420,89 @@ public:
   void readn_if(Channel ch, T *data, uint16_t num, uint32_t splFreq,
     Predicate p)
   {
+    Transaction tr(this);
     auto cmd = createCmd(ch);
-    while (!p(execute(cmd))) {}
+    Timing t(this);
+    while (!p(execute(cmd))) t.lap();
+    endTrigger(t);
+    Hooks::onTriggerArmed();
     execute(cmd, data, num, getSplDelay(ch, splFreq));
   }
 
+  /**
+   * Reads the supplied channel and passes N values to the supplied
+   * sink, without storing them. The sink is called once per sample
+   * with the converted raw value, and can be any callable object
+   * like a lambda or a processing stage.
+   * The SPI interface must be initialized and put in a usable state
+   * before calling this function.
+   * @param [in] ch defines the channel to read from.
+   * @param [in] sink callable receiving every sample.
+   * @param [in] num number of reads.
+   */
+  template <typename Sink>
+  void readn_to(Channel ch, Sink &&sink, uint16_t num) const
+  {
+    Transaction tr(this);
+    stream(createCmd(ch), sink, num);
+  }
+
+  /**
+   * Reads the supplied channel limited to the specified frequency and
+   * passes N values to the supplied sink, without storing them.
+   * The sample rate limit is software controlled, and has a low precision.
+   * The SPI interface must be initialized and put in a usable state
+   * before calling this function.
+   * @param [in] ch defines the channel to read from.
+   * @param [in] sink callable receiving every sample.
+   * @param [in] num number of reads.
+   * @param [in] splFreq sample frequency limit in hz.
+   */
+  template <typename Sink>
+  void readn_to(Channel ch, Sink &&sink, uint16_t num, uint32_t splFreq)
+  {
+    Transaction tr(this);
+    stream(createCmd(ch), sink, num, getSplDelay(ch, splFreq));
+  }
+
+  /**
+   * Reads the supplied channels in sequence and stores N frames
+   * interleaved in the supplied data array, one value per channel
+   * and frame. The SPI interface must be initialized and put in a
+   * usable state before calling this function.
+   * @param [in] chs array of channels to read from, in frame order.
+   * @param [out] data array to store the values.
+   * @param [in] frames number of frames. The data array needs to be
+   * at least frames times the number of channels in size.
+   */
+  template <typename T, size_t M>
+  void scan(const Channel (&chs)[M], T *data, uint16_t frames) const
+  {
+    Transaction tr(this);
+    Command<Channel> cmds[M];
+    for (size_t c=0; c < M; c++) cmds[c] = createCmd(chs[c]);
+    executeScan(cmds, M, data, frames);
+  }
+
+  /**
+   * Reads the supplied channels in sequence and passes N frames to
+   * the supplied sink, without storing them. The sink is called once
+   * per frame with an array of the converted raw values in frame order.
+   * The SPI interface must be initialized and put in a usable state
+   * before calling this function.
+   * @param [in] chs array of channels to read from, in frame order.
+   * @param [in] sink callable receiving every frame.
+   * @param [in] frames number of frames.
+   */
+  template <typename Sink, size_t M>
+  void scan_to(const Channel (&chs)[M], Sink &&sink, uint16_t frames) const
+  {
+    Transaction tr(this);
+    Command<Channel> cmds[M];
+    for (size_t c=0; c < M; c++) cmds[c] = createCmd(chs[c]);
+    streamScan(cmds, sink, frames);
+  }
+
   /**
    * Performs a sampling speed test over 64 reads. The SPI interface
    * must be initialized and put in a usable state before
@@ -325,6 +532,73 @@ public:
    */
   uint32_t testSplSpeed(Channel ch, uint16_t num, uint32_t splFreq);
 
+  /**
+   * Records the interval between consecutive reads into the supplied
+   * histogram. The histogram is centered around the average sampling
+   * time. The SPI interface must be initialized and put in a usable
+   * state before calling this function.
+   * @param [in] ch the channel to use for the test.
+   * @param [in] num the number of reads to perform.
+   * @param [out] jitter the histogram to record the intervals.
+   */
+  void testSplJitter(Channel ch, uint16_t num,
+    MCP320xProfile::Jitter &jitter) const;
+
+  /**
+   * Records the interval between consecutive reads limited to the
+   * specified frequency into the supplied histogram. The histogram is
+   * centered around the average sampling time. The SPI interface must be
+   * initialized and put in a usable state before calling this function.
+   * @param [in] ch the channel to use for the test.
+   * @param [in] num the number of reads to perform.
+   * @param [in] splFreq sample frequency limit in hz.
+   * @param [out] jitter the histogram to record the intervals.
+   */
+  void testSplJitter(Channel ch, uint16_t num, uint32_t splFreq,
+    MCP320xProfile::Jitter &jitter);
+
+  /**
+   * Lets the object manage its SPI transactions with the supplied
+   * settings. Each read, scan or test is wrapped in a transaction,
+   * so the bus can be shared with other devices. The SPI interface
+   * must only be initialized.
+   * @param [in] settings the SPI settings to use.
+   */
+  void setSpiSettings(const SPISettings &settings);
+
+  /**
+   * Begins a SPI transaction, which is held over all following calls
+   * until endTransaction(). Calls within skip the transaction handling,
+   * which saves the settings reprogramming for a sequence of single
+   * reads. Can be nested, has no effect without managed settings.
+   */
+  void beginTransaction() const;
+
+  /**
+   * Ends a SPI transaction started with beginTransaction().
+   */
+  void endTransaction() const;
+
+  /**
+   * Attaches acquisition statistics counters, which are updated by
+   * all following reads.
+   * @param [in] counters the counters to update, nullptr to detach.
+   */
+  void setCounters(MCP320xProfile::Counters *counters);
+
+  /**
+   * Returns the attached acquisition statistics counters.
+   * @return the counters, nullptr if not attached.
+   */
+  MCP320xProfile::Counters *getCounters() const;
+
+  /**
+   * Returns the calibrated sampling time of one sample, which is also
+   * the delay between two channels of a scan frame.
+   * @return the sampling time in ns, 0 if not calibrated.
+   */
+  uint32_t getSplSpeed() const;
+
   /**
    * Converts the supplied raw value to an analog value in mV based on
    * the defined reference voltage.
@@ -368,6 +642,71 @@ private:
     };
   };
 
+  /**
+   * Scoped SPI transaction of a read. Begins the transaction if the
+   * object manages its transactions and none is active. Ends the loop
+   * time of the phase profile.
+   */
+  class Transaction {
+  public:
+    explicit Transaction(const MCP320x *adc)
+      : mAdc(adc)
+    {
+      mAdc->beginTransaction();
+    }
+
+    ~Transaction()
+    {
+      mAdc->endTransaction();
+      MCP320X_PHASE_STOP();
+    }
+
+  private:
+    const MCP320x *mAdc;
+  };
+
+  /**
+   * Elapsed time of a read for the attached counters. High resolution
+   * timestamps wrap within seconds, the time is accumulated from the
+   * timestamp difference of every sample. Costs nothing without
+   * attached counters.
+   */
+  class Timing {
+  public:
+    explicit Timing(const MCP320x *adc)
+      : mEnabled(adc->mCounters != nullptr)
+      , mLast(mEnabled ? MCP320xClock::ticks() : 0)
+      , mElapsed(0) {}
+
+    /**
+     * Accumulates the time since the last call, once per sample.
+     */
+    void lap()
+    {
+      if (!MCP320xClock::kHighRes || !mEnabled) return;
+      uint32_t t = MCP320xClock::ticks();
+      mElapsed += t - mLast;
+      mLast = t;
+    }
+
+    /**
+     * Returns the elapsed time.
+     * @return the time since the start in clock ticks.
+     */
+    uint64_t elapsed()
+    {
+      if (!mEnabled) return 0;
+      if (!MCP320xClock::kHighRes) return MCP320xClock::ticks() - mLast;
+      lap();
+      return mElapsed;
+    }
+
+  private:
+    bool mEnabled;
+    uint32_t mLast;
+    uint64_t mElapsed;
+  };
+
   /**
    * SPI command for a specific channel type.
    */
@@ -381,6 +720,40 @@ private:
    */
   uint16_t getSplDelay(Channel ch, uint32_t splFreq);
 
+  /**
+   * Measures the average sampling time of the supplied command.
+   * Uses the CPU cycle counter where available.
+   * @param [in] cmd the command to execute.
+   * @param [in] num the number of reads to perform.
+   * @param [in] delay in us between reads.
+   * @return the average sampling time needed for one sample in ns.
+   */
+  uint32_t measure(Command<Channel> cmd, uint16_t num, uint16_t delay) const;
+
+  /**
+   * Records the interval between consecutive executions of the
+   * supplied command.
+   * @param [in] cmd the command to execute.
+   * @param [in] num the number of reads to perform.
+   * @param [in] delay in us between reads.
+   * @param [out] jitter the histogram to record the intervals.
+   */
+  void profile(Command<Channel> cmd, uint16_t num, uint16_t delay,
+    MCP320xProfile::Jitter &jitter) const;
+
+  /**
+   * Completes a read of multiple samples for the attached counters.
+   * @param [in] t the timing of the read.
+   * @param [in] num number of samples.
+   */
+  void endBlock(Timing &t, uint32_t num) const;
+
+  /**
+   * Completes a trigger wait for the attached counters.
+   * @param [in] t the timing of the wait.
+   */
+  void endTrigger(Timing &t) const;
+
   /**
    * Creates a command from the supplied channel.
    * @param [in] ch the channel to create the command for.
@@ -406,8 +779,12 @@ private:
   template <typename T>
   void execute(Command<Channel> cmd, T *data, uint16_t num) const
   {
-    for (decltype(num) i=0; i < num; i++)
+    Timing t(this);
+    for (decltype(num) i=0; i < num; i++) {
       data[i] = static_cast<T>(execute(cmd));
+      t.lap();
+    }
+    endBlock(t, num);
   }
 
   /**
@@ -423,34 +800,223 @@ private:
   void execute(Command<Channel> cmd, T *data, uint16_t num,
     uint16_t delay) const
   {
+    Timing t(this);
     for (decltype(num) i=0; i < num; i++) {
       data[i] = static_cast<T>(execute(cmd));
       delayMicroseconds(delay);
+      t.lap();
+    }
+    endBlock(t, num);
+  }
+
+  /**
+   * Executes the supplied commands in sequence for the requested
+   * number of frames.
+   * @param [in] cmds array of commands to execute.
+   * @param [in] num number of commands per frame.
+   * @param [out] data array to store the values.
+   * @param [in] frames number of frames. The data array needs to be
+   * at least frames times num in size.
+   */
+  template <typename T>
+  void executeScan(const Command<Channel> *cmds, size_t num, T *data,
+    uint16_t frames) const
+  {
+    Timing t(this);
+    for (decltype(frames) f=0; f < frames; f++) {
+      for (size_t c=0; c < num; c++)
+        *data++ = static_cast<T>(execute(cmds[c]));
+      t.lap();
+    }
+    endBlock(t, static_cast<uint32_t>(frames) * num);
+  }
+
+  /**
+   * Executes the supplied commands in sequence for the requested
+   * number of frames and passes every frame to the sink.
+   * @param [in] cmds array of commands to execute.
+   * @param [in] sink callable receiving every frame.
+   * @param [in] frames number of frames.
+   */
+  template <typename Sink, size_t M>
+  void streamScan(const Command<Channel> (&cmds)[M], Sink &sink,
+    uint16_t frames) const
+  {
+    uint16_t frame[M];
+    Timing t(this);
+    for (decltype(frames) f=0; f < frames; f++) {
+      for (size_t c=0; c < M; c++) frame[c] = execute(cmds[c]);
+      sink(static_cast<const uint16_t *>(frame));
+      t.lap();
+    }
+    endBlock(t, static_cast<uint32_t>(frames) * M);
+  }
+
+  /**
+   * Executes the supplied command for the requested number
+   * of samples and passes every value to the sink.
+   * @param [in] cmd the command to execute.
+   * @param [in] sink callable receiving every sample.
+   * @param [in] num number of reads.
+   */
+  template <typename Sink>
+  void stream(Command<Channel> cmd, Sink &sink, uint16_t num) const
+  {
+    Timing t(this);
+    for (decltype(num) i=0; i < num; i++) {
+      sink(execute(cmd));
+      t.lap();
+    }
+    endBlock(t, num);
+  }
+
+  /**
+   * Executes the supplied command for the requested number
+   * of samples with delay between reads and passes every
+   * value to the sink.
+   * @param [in] cmd the command to execute.
+   * @param [in] sink callable receiving every sample.
+   * @param [in] num number of reads.
+   * @param [in] delay in us.
+   */
+  template <typename Sink>
+  void stream(Command<Channel> cmd, Sink &sink, uint16_t num,
+    uint16_t delay) const
+  {
+    Timing t(this);
+    for (decltype(num) i=0; i < num; i++) {
+      sink(execute(cmd));
+      delayMicroseconds(delay);
+      t.lap();
+    }
+    endBlock(t, num);
+  }
+
+  /**
+   * Executes the supplied command and validates the response frame.
+   * @param [in] cmd the command to execute.
+   * @param [out] value the ADC value from the SPI response.
+   * @return true if the frame was valid.
+   */
+  bool executeChecked(Command<Channel> cmd, uint16_t &value) const;
+
+  /**
+   * Executes the supplied command for the requested number of samples
+   * and validates the response frames.
+   * @param [in] cmd the command to execute.
+   * @param [out] data array to store the values.
+   * @param [in] num number of reads.
+   * @param [in] policy the handling of invalid frames.
+   * @return the number of valid frames.
+   */
+  template <typename T>
+  uint16_t executeChecked(Command<Channel> cmd, T *data, uint16_t num,
+    FramePolicy policy) const
+  {
+    uint16_t valid = 0;
+    Timing t(this);
+    for (decltype(num) i=0; i < num; i++) {
+      uint16_t value;
+      if (executeChecked(cmd, value)) {
+        valid++;
+      } else if (policy == FAIL_FAST) {
+        num = i + 1;
+        break;
+      }
+      data[i] = static_cast<T>(value);
+      t.lap();
     }
+    endBlock(t, num);
+    return valid;
   }
 
+  /**
+   * Transfers the supplied command and returns the unmasked response
+   * frame of the chip.
+   * @param [in] cmd the command to transfer.
+   * @return the SPI response frame.
+   */
+  SpiData frame(Command<Channel> cmd) const;
+
+  /**
+   * Checks the null bit of the supplied response frame. The MCP3201
+   * additionally repeats bit 1 lsb first, which must match.
+   * @param [in] frame the SPI response frame.
+   * @return true if the frame is valid.
+   */
+  static bool isValid(SpiData frame);
+
+  /**
+   * Extracts the ADC value from the supplied response frame.
+   * @param [in] frame the SPI response frame.
+   * @return the ADC value.
+   */
+  static uint16_t toValue(SpiData frame);
+
+  /**
+   * Tests the reliability of the current SPI clock. Checks the frames
+   * of the supplied channel and the repeatability of the reference
+   * channel.
+   * @param [in] ch the channel to test.
+   * @param [in] ref the reference channel.
+   * @param [in] tolerance the maximum spread of the reference in LSB.
+   * @param [out] mean the mean value of the reference channel.
+   * @return true if all frames were valid and within the tolerance.
+   */
+  bool testClock(Channel ch, Channel ref, uint16_t tolerance,
+    uint16_t &mean) const;
+
+  /**
+   * Sets the managed settings to the supplied clock in mode 0 and
+   * restarts an active managed transaction with them. Transactions of
+   * the application are never touched.
+   * @param [in] clock the SPI clock in hz.
+   */
+  void setSpiClock(uint32_t clock);
+
+  /**
+   * Returns the SPI clock applied by the hardware for the requested
+   * clock, e.g. the next lower F_CPU/2^k on AVR.
+   * @param [in] clock the requested SPI clock in hz.
+   * @return the effective SPI clock in hz.
+   */
+  static uint32_t toSpiClock(uint32_t clock);
+
   /**
    * Transfers without SPI command data.
-   * @return the ADC value from the SPI response.
+   * @return the raw SPI response |x|x|null|11|10|9|8|7| |6|5|4|3|2|1|0|1|.
    */
-  uint16_t transfer() const;
+  SpiData transfer() const;
 
   /**
    * Transfers the supplied SPI command data.
    * @param [in] cmd the SPI command data to transfer.
-   * @return the ADC value from the SPI response.
+   * @return the raw SPI response |x|x|x|null|11|10|9|8| |7|6|5|4|3|2|1|0|.
    */
-  uint16_t transfer(SpiData cmd) const;
+  SpiData transfer(SpiData cmd) const;
 
 private:
 
   uint16_t mVref;
   uint8_t mCsPin;
+  uint8_t mCalCh;
   uint32_t mSplSpeed;
   SPIClass *mSpi;
+  SPISettings mSettings;
+  bool mManaged;
+  mutable uint8_t mDepth;
+  MCP320xProfile::Counters *mCounters;
 };
 
 using MCP3201 = MCP320x<MCP320xTypes::MCP3201::Channel>;
 using MCP3202 = MCP320x<MCP320xTypes::MCP3202::Channel>;
 using MCP3204 = MCP320x<MCP320xTypes::MCP3204::Channel>;
 using MCP3208 = MCP320x<MCP320xTypes::MCP3208::Channel>;
+
+/*
+ * The default configurations are instantiated by the library.
+ */
+extern template class MCP320x<MCP320xTypes::MCP3201::Channel>;
+extern template class MCP320x<MCP320xTypes::MCP3202::Channel>;
+extern template class MCP320x<MCP320xTypes::MCP3204::Channel>;
+extern template class MCP320x<MCP320xTypes::MCP3208::Channel>;
@@ -0,0 +1,57 @@
+/**
+ * @file Mcp320xArbiter.cpp
+ * @author  Patrick Rogalla <patrick@labfruits.com>
+ */
+#include "Mcp320xArbiter.h"
+
+namespace MCP320xBus {
+
+Arbiter::Arbiter(uint32_t splFreq, uint32_t guard)
+  : mPeriod(MCP320xClock::fromNs((1000000000UL + (splFreq >> 1)) / splFreq))
+  , mGuard(MCP320xClock::fromNs(guard))
+  , mCost(0)
+  , mStats()
+  , mJitter(nullptr) {}
+
+void Arbiter::setJitter(MCP320xProfile::Jitter *jitter)
+{
+  mJitter = jitter;
+}
+
+uint32_t Arbiter::getChunkCost() const
+{
+  return MCP320xClock::toNs(mCost);
+}
+
+Arbiter::Stats Arbiter::getStats() const
+{
+  Stats stats = mStats;
+  stats.maxLate = MCP320xClock::toNs(mStats.maxLate);
+  return stats;
+}
+
+void Arbiter::start()
+{
+  MCP320xClock::begin();
+  mStats = {};
+  if (mJitter) mJitter->begin(MCP320xClock::toNs(mPeriod));
+}
+
+void Arbiter::slot(uint32_t now, uint32_t &next, uint32_t last)
+{
+  if (mStats.slots++ && mJitter) mJitter->add(now - last);
+
+  int32_t late = now - next;
+  if (late <= 0) return;
+
+  if (static_cast<uint32_t>(late) > mGuard) mStats.late++;
+  if (static_cast<uint32_t>(late) > mStats.maxLate) mStats.maxLate = late;
+
+  // restart the schedule instead of catching up with a burst
+  if (static_cast<uint32_t>(late) > mPeriod) {
+    mStats.missed += late / mPeriod;
+    next = now;
+  }
+}
+
+}; // namespace MCP320xBus
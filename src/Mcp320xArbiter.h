@@ -0,0 +1,169 @@
+/**
+ * @file Mcp320xArbiter.h
+ * @author Patrick Rogalla <patrick@labfruits.com>
+ *
+ * Cooperative bus arbiter, which interleaves background bus work like
+ * SD card writes with rate limited sampling on a shared SPI bus.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <Arduino.h>
+#include "Mcp320xClock.h"
+#include "Mcp320xJitter.h"
+
+namespace MCP320xBus {
+
+/**
+ * Runs a sample function on a fixed schedule and slices background work
+ * into the slack between two samples. The background work is performed
+ * in chunks by a chunk function, which must not block longer than a few
+ * sample periods, e.g. by polling the busy state of a SD card instead of
+ * waiting. A chunk is only started if the time to the next sample is
+ * larger than the estimated chunk cost plus the guard time. The estimate
+ * rises with the longest observed chunk and decays slowly, also on each
+ * slot without a chunk, so a single slow chunk does not stall the work.
+ * All devices on the bus must use SPI transactions, see
+ * MCP320x::setSpiSettings.
+ */
+class Arbiter {
+
+public:
+
+  /**
+   * Defines the schedule statistics of the last run.
+   */
+  struct Stats {
+    uint32_t slots;    /**< number of sample slots */
+    uint32_t late;     /**< slots started later than the guard time */
+    uint32_t maxLate;  /**< largest sample start delay in ns */
+    uint32_t missed;   /**< slots lost, the schedule was restarted */
+    uint32_t chunks;   /**< number of performed chunks */
+    uint32_t skipped;  /**< slots with too little slack for a chunk */
+  };
+
+  /**
+   * Initiates an arbiter.
+   * @param [in] splFreq the sample frequency in hz.
+   * @param [in] guard the time in ns kept free before each sample.
+   */
+  explicit Arbiter(uint32_t splFreq, uint32_t guard = 2000);
+
+  /**
+   * Attaches a histogram, which records the intervals between samples
+   * of the following runs. The histogram is centered around the sample
+   * period.
+   * @param [in] jitter the histogram, nullptr to detach.
+   */
+  void setJitter(MCP320xProfile::Jitter *jitter);
+
+  /**
+   * Samples on the schedule and performs background chunks in between.
+   * @param [in] num the number of samples.
+   * @param [in] sample function performing one sample, e.g. adc.read.
+   * @param [in] chunk function performing one chunk of background work,
+   * returns false if no work is pending.
+   */
+  template <typename Sample, typename Chunk>
+  void run(uint32_t num, Sample &&sample, Chunk &&chunk)
+  {
+    start();
+
+    uint32_t next = MCP320xClock::ticks();
+    uint32_t last = next;
+    for (uint32_t i = 0; i < num; i++) {
+      uint32_t now = MCP320xClock::ticks();
+      slot(now, next, last);
+      last = now;
+      sample();
+      next += mPeriod;
+
+      // background chunks in the slack before the next sample
+      for (;;) {
+        now = MCP320xClock::ticks();
+        if (static_cast<int32_t>(next - now) <
+            static_cast<int32_t>(mCost + mGuard)) {
+          skip();
+          break;
+        }
+        if (!chunk()) break;
+        estimate(MCP320xClock::ticks() - now);
+      }
+
+      wait(next);
+    }
+  }
+
+  /**
+   * Returns the estimated cost of one chunk.
+   * @return the cost in ns.
+   */
+  uint32_t getChunkCost() const;
+
+  /**
+   * Returns the schedule statistics of the last run.
+   * @return the statistics.
+   */
+  Stats getStats() const;
+
+private:
+
+  /**
+   * Resets the statistics and the histogram.
+   */
+  void start();
+
+  /**
+   * Records the start of a sample slot, restarts the schedule if more
+   * than one slot was missed.
+   * @param [in] now the start time in ticks.
+   * @param [in,out] next the scheduled time in ticks.
+   * @param [in] last the start time of the previous slot in ticks.
+   */
+  void slot(uint32_t now, uint32_t &next, uint32_t last);
+
+  /**
+   * Records a slot without enough slack for a chunk.
+   */
+  void skip()
+  {
+    mStats.skipped++;
+    mCost -= mCost >> 6;
+  }
+
+  /**
+   * Updates the chunk cost estimate.
+   * @param [in] t the duration of the last chunk in ticks.
+   */
+  void estimate(uint32_t t)
+  {
+    mStats.chunks++;
+    if (t > mCost) mCost = t;
+    else mCost -= (mCost - t) >> 4;
+  }
+
+  /**
+   * Waits until the supplied time.
+   * @param [in] t the time in ticks.
+   */
+  static void wait(uint32_t t)
+  {
+    int32_t left = t - MCP320xClock::ticks();
+    if (left <= 0) return;
+
+    uint32_t us = MCP320xClock::toNs(left) / 1000;
+    if (us) delayMicroseconds(us);
+    while (static_cast<int32_t>(t - MCP320xClock::ticks()) > 0);
+  }
+
+private:
+
+  uint32_t mPeriod;
+  uint32_t mGuard;
+  uint32_t mCost;
+  Stats mStats;
+  MCP320xProfile::Jitter *mJitter;
+};
+
+}; // namespace MCP320xBus
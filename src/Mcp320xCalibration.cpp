@@ -0,0 +1,36 @@
+/**
+ * @file Mcp320xCalibration.cpp
+ * @author  Patrick Rogalla <patrick@labfruits.com>
+ */
+#include <stddef.h>
+#include "Mcp320xCalibration.h"
+
+namespace MCP320xTypes {
+
+void Calibration::seal()
+{
+  magic = kMagic;
+  reserved = 0;
+  crc = checksum();
+}
+
+bool Calibration::isValid() const
+{
+  return magic == kMagic && crc == checksum();
+}
+
+uint16_t Calibration::checksum() const
+{
+  const uint8_t *data = reinterpret_cast<const uint8_t *>(this);
+  uint16_t res = 0xFFFF;
+
+  for (size_t i = 0; i < offsetof(Calibration, crc); i++) {
+    res ^= static_cast<uint16_t>(data[i]) << 8;
+    for (uint8_t b = 0; b < 8; b++)
+      res = (res & 0x8000) ? (res << 1) ^ 0x1021 : (res << 1);
+  }
+
+  return res;
+}
+
+}; // namespace MCP320xTypes
@@ -0,0 +1,68 @@
+/**
+ * @file Mcp320xCalibration.h
+ * @author Patrick Rogalla <patrick@labfruits.com>
+ *
+ * Calibration profile, which persists the result of calibrate() to skip
+ * the calibration on warm boots. The profile is a plain structure, which
+ * can be stored as is in EEPROM, flash or a host file. It is stored in
+ * the native layout and is only valid on the platform it was exported on.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+namespace MCP320xTypes {
+
+/**
+ * Calibration result keyed by SPI clock, board and channel.
+ */
+struct Calibration {
+
+  /** Magic number and layout version of the profile. */
+  static const uint16_t kMagic = 0x3201;
+
+  uint16_t magic;     /**< magic number, kMagic if sealed */
+  uint8_t channel;    /**< channel used for the calibration */
+  uint8_t reserved;   /**< reserved, 0 */
+  uint32_t spiClock;  /**< SPI clock in hz */
+  uint32_t boardId;   /**< user defined board identifier */
+  uint32_t splSpeed;  /**< sampling time of one sample in ns */
+  uint16_t crc;       /**< CRC-16 of all previous fields */
+
+  /**
+   * Sets the magic number and the checksum. Must be called after
+   * all fields are set.
+   */
+  void seal();
+
+  /**
+   * Checks the magic number and the checksum.
+   * @return true if the profile is intact.
+   */
+  bool isValid() const;
+
+  /**
+   * Checks whether the profile is intact and was created for the
+   * supplied key.
+   * @param [in] clock the SPI clock in hz.
+   * @param [in] board the board identifier.
+   * @param [in] ch the channel.
+   * @return true if the profile matches.
+   */
+  bool matches(uint32_t clock, uint32_t board, uint8_t ch) const
+  {
+    return isValid() && spiClock == clock && boardId == board &&
+      channel == ch && splSpeed;
+  }
+
+private:
+
+  /**
+   * Calculates the CRC-16/CCITT of the profile fields.
+   * @return the checksum.
+   */
+  uint16_t checksum() const;
+};
+
+}; // namespace MCP320xTypes
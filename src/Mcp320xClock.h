@@ -0,0 +1,165 @@
+/**
+ * @file Mcp320xClock.h
+ * @author Patrick Rogalla <patrick@labfruits.com>
+ *
+ * High resolution timestamps for timing measurements. Uses the CPU
+ * cycle counter where available and falls back to micros(). With
+ * MCP320X_CLOCK_EXTERNAL defined the application supplies the clock.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#if !defined(ARDUINO) && !defined(MCP320X_CLOCK_EXTERNAL)
+#include <time.h>
+#else
+#include <Arduino.h>
+#endif
+
+namespace MCP320xClock {
+
+#if defined(MCP320X_CLOCK_EXTERNAL)
+
+/*
+ * Application supplied clock, e.g. the virtual time of a simulation.
+ * Takes precedence over the cycle counters.
+ */
+
+/** Timestamps are ns. */
+static const bool kHighRes = true;
+
+inline void begin() {}
+
+/**
+ * Returns the current time in ns, implemented by the application.
+ */
+uint32_t ticks();
+
+inline uint64_t toNs(uint64_t t)
+{
+  return t;
+}
+
+inline uint64_t fromNs(uint64_t ns)
+{
+  return ns;
+}
+
+#elif defined(ARDUINO) && (defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__))
+
+/*
+ * Cortex-M3/M4/M7, DWT cycle counter.
+ */
+#define MCP320X_DEMCR      (*reinterpret_cast<volatile uint32_t *>(0xE000EDFC))
+#define MCP320X_DWT_CTRL   (*reinterpret_cast<volatile uint32_t *>(0xE0001000))
+#define MCP320X_DWT_CYCCNT (*reinterpret_cast<volatile uint32_t *>(0xE0001004))
+
+/** Timestamps are CPU cycles. */
+static const bool kHighRes = true;
+
+inline void begin()
+{
+  // enable trace and the cycle counter
+  MCP320X_DEMCR |= (1UL << 24);
+  MCP320X_DWT_CTRL |= 1;
+}
+
+inline uint32_t ticks()
+{
+  return MCP320X_DWT_CYCCNT;
+}
+
+inline uint64_t toNs(uint64_t t)
+{
+  return (t * 1000) / (F_CPU / 1000000UL);
+}
+
+inline uint64_t fromNs(uint64_t ns)
+{
+  return (ns * (F_CPU / 1000000UL)) / 1000;
+}
+
+#elif defined(ARDUINO) && (defined(ESP32) || defined(ESP8266))
+
+/*
+ * ESP32/ESP8266, CCOUNT cycle counter.
+ */
+
+/** Timestamps are CPU cycles. */
+static const bool kHighRes = true;
+
+inline void begin() {}
+
+inline uint32_t ticks()
+{
+  return ESP.getCycleCount();
+}
+
+inline uint64_t toNs(uint64_t t)
+{
+  return (t * 1000) / ESP.getCpuFreqMHz();
+}
+
+inline uint64_t fromNs(uint64_t ns)
+{
+  return (ns * ESP.getCpuFreqMHz()) / 1000;
+}
+
+#elif !defined(ARDUINO)
+
+/*
+ * Host, monotonic clock.
+ */
+
+/** Timestamps are ns. */
+static const bool kHighRes = true;
+
+inline void begin() {}
+
+inline uint32_t ticks()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<uint32_t>(ts.tv_sec * 1000000000ULL + ts.tv_nsec);
+}
+
+inline uint64_t toNs(uint64_t t)
+{
+  return t;
+}
+
+inline uint64_t fromNs(uint64_t ns)
+{
+  return ns;
+}
+
+#else
+
+/*
+ * Fallback, micros().
+ */
+
+/** Timestamps are us, with the resolution of micros(). */
+static const bool kHighRes = false;
+
+inline void begin() {}
+
+inline uint32_t ticks()
+{
+  return micros();
+}
+
+inline uint64_t toNs(uint64_t t)
+{
+  return t * 1000;
+}
+
+inline uint64_t fromNs(uint64_t ns)
+{
+  return ns / 1000;
+}
+
+#endif
+
+}; // namespace MCP320xClock
@@ -0,0 +1,106 @@
+/**
+ * @file Mcp320xCounters.cpp
+ * @author  Patrick Rogalla <patrick@labfruits.com>
+ */
+#include "Mcp320xCounters.h"
+#include "Mcp320xClock.h"
+
+namespace MCP320xProfile {
+
+Counters::Counters()
+  : mSeq(0)
+{
+  reset();
+}
+
+void Counters::reset()
+{
+  begin();
+  mState = {};
+  mState.triggerMin = UINT64_MAX;
+  end();
+}
+
+Counters::Snapshot Counters::snapshot() const
+{
+  State s;
+  load(s, 0);
+  return evaluate(s);
+}
+
+bool Counters::trySnapshot(Snapshot &snap, uint8_t tries) const
+{
+  State s;
+  if (!load(s, tries ? tries : 1)) return false;
+  snap = evaluate(s);
+  return true;
+}
+
+bool Counters::load(State &s, uint8_t tries) const
+{
+  // copy the state until no write section overlapped
+  for (;;) {
+    uint32_t seq = mSeq;
+    MCP320X_BARRIER();
+    s = mState;
+    MCP320X_BARRIER();
+    if (!(seq & 1) && seq == mSeq) return true;
+    if (tries && !--tries) return false;
+  }
+}
+
+Counters::Snapshot Counters::evaluate(const State &s)
+{
+  Snapshot snap;
+  snap.conversions = s.conversions;
+  snap.bytes = s.bytes;
+  snap.overruns = s.overruns;
+  snap.triggers = s.triggers;
+  snap.triggerMin = s.triggers ? MCP320xClock::toNs(s.triggerMin) : 0;
+  snap.triggerMax = MCP320xClock::toNs(s.triggerMax);
+  snap.frameErrors = s.frameErrors;
+
+  uint64_t ns = MCP320xClock::toNs(s.blockTicks);
+  uint64_t samples = s.blockSamples;
+  // keep the scaled sample count within 64 bit
+  while (samples > UINT64_MAX / 1000000000ULL) {
+    samples >>= 1;
+    ns >>= 1;
+  }
+  snap.rate = ns ? (samples * 1000000000ULL + (ns >> 1)) / ns : 0;
+
+  return snap;
+}
+
+void Counters::overrun()
+{
+  begin();
+  mState.overruns++;
+  end();
+}
+
+void Counters::block(uint32_t num, uint64_t t)
+{
+  begin();
+  mState.blockSamples += num;
+  mState.blockTicks += t;
+  end();
+}
+
+void Counters::trigger(uint64_t t)
+{
+  begin();
+  mState.triggers++;
+  if (t < mState.triggerMin) mState.triggerMin = t;
+  if (t > mState.triggerMax) mState.triggerMax = t;
+  end();
+}
+
+void Counters::frameError()
+{
+  begin();
+  mState.frameErrors++;
+  end();
+}
+
+}; // namespace MCP320xProfile
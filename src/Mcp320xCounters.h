@@ -0,0 +1,162 @@
+/**
+ * @file Mcp320xCounters.h
+ * @author Patrick Rogalla <patrick@labfruits.com>
+ *
+ * Runtime acquisition statistics counters.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "Mcp320xSeqLock.h"
+
+namespace MCP320xProfile {
+
+/**
+ * Acquisition statistics of a MCP320x object, attached with
+ * MCP320x::setCounters. The counters are updated in the acquisition
+ * path with plain increments under a sequence lock, a consistent
+ * snapshot can be taken from another core or task. An interrupt, which
+ * can preempt the writer on the same core, must use trySnapshot, as the
+ * interrupted write section never ends while the reader spins.
+ */
+class Counters {
+
+public:
+
+  /**
+   * Defines a consistent snapshot of the counters.
+   */
+  struct Snapshot {
+    uint32_t conversions;  /**< number of conversions */
+    uint32_t bytes;        /**< number of transferred SPI bytes */
+    uint32_t overruns;     /**< rate limited reads slower than requested */
+    uint32_t triggers;     /**< number of triggered reads */
+    uint64_t triggerMin;   /**< shortest trigger wait in ns */
+    uint64_t triggerMax;   /**< longest trigger wait in ns */
+    uint32_t rate;         /**< achieved sample rate within reads in hz */
+    uint32_t frameErrors;  /**< invalid frames of validated reads */
+  };
+
+  /**
+   * Initiates cleared counters.
+   */
+  Counters();
+
+  /**
+   * Clears all counters.
+   */
+  void reset();
+
+  /**
+   * Takes a consistent snapshot of the counters. Spins until no write
+   * section overlaps, must not be called from an interrupt, which
+   * preempts the writer.
+   * @return the counter values.
+   */
+  Snapshot snapshot() const;
+
+  /**
+   * Tries to take a consistent snapshot of the counters with a bounded
+   * number of attempts. Safe to call from an interrupt, which preempts
+   * the writer.
+   * @param [out] snap the counter values.
+   * @param [in] tries maximum number of attempts, at least 1.
+   * @return true if the snapshot is consistent, false if a write
+   * section overlapped every attempt.
+   */
+  bool trySnapshot(Snapshot &snap, uint8_t tries = 4) const;
+
+  /**
+   * Counts a conversion. Used by MCP320x.
+   * @param [in] bytes number of transferred SPI bytes.
+   */
+  void conversion(uint8_t bytes)
+  {
+    begin();
+    mState.conversions++;
+    mState.bytes += bytes;
+    end();
+  }
+
+  /**
+   * Counts a rate limited read, that cannot reach the requested
+   * sample rate. Used by MCP320x.
+   */
+  void overrun();
+
+  /**
+   * Counts a completed read of multiple samples. Used by MCP320x.
+   * @param [in] num number of samples.
+   * @param [in] t duration in clock ticks.
+   */
+  void block(uint32_t num, uint64_t t);
+
+  /**
+   * Counts a triggered read. Used by MCP320x.
+   * @param [in] t trigger wait time in clock ticks.
+   */
+  void trigger(uint64_t t);
+
+  /**
+   * Counts an invalid frame of a validated read. Used by MCP320x.
+   */
+  void frameError();
+
+private:
+
+  /**
+   * Defines the counter state.
+   */
+  struct State {
+    uint32_t conversions;
+    uint32_t bytes;
+    uint32_t overruns;
+    uint32_t triggers;
+    uint64_t triggerMin;
+    uint64_t triggerMax;
+    uint64_t blockSamples;
+    uint64_t blockTicks;
+    uint32_t frameErrors;
+  };
+
+  /**
+   * Copies the state consistently.
+   * @param [out] s the copied state.
+   * @param [in] tries maximum number of attempts, 0 for no limit.
+   * @return true if no write section overlapped the copy.
+   */
+  bool load(State &s, uint8_t tries) const;
+
+  /**
+   * Converts the supplied state to a snapshot.
+   * @param [in] s the counter state.
+   * @return the counter values.
+   */
+  static Snapshot evaluate(const State &s);
+
+  /**
+   * Starts a write section of the sequence lock.
+   */
+  void begin()
+  {
+    mSeq = mSeq + 1;
+    MCP320X_BARRIER();
+  }
+
+  /**
+   * Ends a write section of the sequence lock.
+   */
+  void end()
+  {
+    MCP320X_BARRIER();
+    mSeq = mSeq + 1;
+  }
+
+private:
+
+  volatile uint32_t mSeq;
+  State mState;
+};
+
+}; // namespace MCP320xProfile
@@ -0,0 +1,151 @@
+/**
+ * @file Mcp320xDeskew.h
+ * @author Patrick Rogalla <patrick@labfruits.com>
+ *
+ * Inter-channel skew compensation for MCP320x scan frames.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+namespace MCP320xDsp {
+
+/**
+ * Returns the interpolation position between the previous and the
+ * current sample of a channel, which is delayed by the supplied time
+ * against the reference instant. Delays beyond one period are limited.
+ * @param [in] delay the channel delay.
+ * @param [in] period the sampling period in the unit of the delay.
+ * @return the interpolation position in Q15, the current sample without
+ * correction if the period is 0.
+ */
+inline uint16_t skewPosition(uint32_t delay, uint32_t period)
+{
+  if (!period) return 32768U;
+  if (delay > period) delay = period;
+  return 32768U - (((static_cast<uint64_t>(delay) << 15) + (period >> 1)) /
+    period);
+}
+
+/**
+ * Interpolates a delayed channel back to the reference instant.
+ * @param [in] prev the previous sample of the channel.
+ * @param [in] cur the current sample of the channel.
+ * @param [in] pos the interpolation position in Q15, see skewPosition.
+ * @return the aligned sample.
+ */
+inline int32_t skewAlign(int32_t prev, int32_t cur, uint16_t pos)
+{
+  return prev + (((cur - prev) * pos) >> 15);
+}
+
+/**
+ * Aligns all channels of a sequentially sampled scan frame to the
+ * sampling instant of the first channel. Every channel is delayed by
+ * its slot position times the sampling time of one sample, and is
+ * linearly interpolated between the previous and the current frame.
+ * The slot delays are derived from the sampling time (see
+ * MCP320x::getSplSpeed) or can be set individually from a calibration.
+ * The sampling time is only known after MCP320x::calibrate, without a
+ * frame period the channels pass without correction.
+ * @tparam M number of channels per frame.
+ */
+template <uint8_t M>
+class Deskew {
+
+public:
+
+  /**
+   * Initiates a skew compensation stage.
+   * @param [in] slotDelay delay between two channels in ns.
+   * @param [in] framePeriod period of one frame in ns, 0 if frames are
+   * sampled back to back (M times the slot delay). If both are 0, e.g.
+   * the sampling time of an uncalibrated ADC, the stage doesn't correct.
+   */
+  explicit Deskew(uint32_t slotDelay, uint32_t framePeriod = 0)
+    : mFramePeriod(framePeriod ? framePeriod : slotDelay * M)
+  {
+    for (uint8_t c = 0; c < M; c++) setSlotDelay(c, slotDelay * c);
+    reset();
+  }
+
+  /**
+   * Resets the stage, the next frame passes unaligned.
+   */
+  void reset()
+  {
+    mFirst = true;
+  }
+
+  /**
+   * Sets the delay of a single channel relative to the first channel,
+   * e.g. from a calibration. Delays beyond one frame period are
+   * limited and show up in the residual skew. Without a frame period
+   * the channel isn't corrected.
+   * @param [in] slot the channel position in the frame.
+   * @param [in] delay the channel delay in ns.
+   */
+  void setSlotDelay(uint8_t slot, uint32_t delay)
+  {
+    mDelay[slot] = delay;
+    mPos[slot] = skewPosition(delay, mFramePeriod);
+  }
+
+  /**
+   * Aligns the supplied frame.
+   * @param [in] frame array of M samples in frame order.
+   * @return the aligned frame, valid until the next call.
+   */
+  const uint16_t *add(const uint16_t *frame)
+  {
+    for (uint8_t c = 0; c < M; c++) {
+      int32_t cur = frame[c];
+      int32_t prev = mFirst ? cur : mPrev[c];
+      mOut[c] = skewAlign(prev, cur, mPos[c]);
+      mPrev[c] = frame[c];
+    }
+    mFirst = false;
+
+    return mOut;
+  }
+
+  /**
+   * Returns the remaining skew after the alignment, caused by the
+   * fixed point interpolation position and limited slot delays.
+   * @return the largest residual channel skew in ns.
+   */
+  uint32_t getResidualSkew() const
+  {
+    uint32_t res = 0;
+    for (uint8_t c = 0; c < M; c++) {
+      // realized delay of the channel
+      uint32_t d = div_round(static_cast<uint64_t>(32768U - mPos[c]) *
+        mFramePeriod, 32768U);
+      uint32_t e = (d > mDelay[c]) ? d - mDelay[c] : mDelay[c] - d;
+      if (e > res) res = e;
+    }
+    return res;
+  }
+
+private:
+
+  /**
+   * Divides n by d and rounds to the nearest integer.
+   */
+  static uint32_t div_round(uint64_t n, uint32_t d)
+  {
+    return (n + (d >> 1)) / d;
+  }
+
+private:
+
+  uint32_t mFramePeriod;
+  bool mFirst;
+  uint32_t mDelay[M];
+  uint16_t mPos[M];
+  uint16_t mPrev[M];
+  uint16_t mOut[M];
+};
+
+}; // namespace MCP320xDsp
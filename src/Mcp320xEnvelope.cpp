@@ -0,0 +1,40 @@
+/**
+ * @file Mcp320xEnvelope.cpp
+ * @author  Patrick Rogalla <patrick@labfruits.com>
+ */
+#include "Mcp320xEnvelope.h"
+
+namespace MCP320xDsp {
+
+Envelope::Envelope(uint8_t attack, uint8_t decay, uint16_t decimation,
+  uint32_t hold, uint16_t offset)
+  : mAttack(attack)
+  , mDecay(decay)
+  , mDecimation(decimation)
+  , mHold(hold)
+  , mOffset(offset)
+{
+  reset();
+}
+
+void Envelope::reset()
+{
+  mEnv = 0;
+  mOut = 0;
+  mCount = 0;
+  mPeak = 0;
+  mHeld = 0;
+  mHoldCount = 0;
+}
+
+uint16_t Envelope::getEnvelope() const
+{
+  return mOut;
+}
+
+uint16_t Envelope::getPeak() const
+{
+  return (mPeak > mHeld) ? mPeak : mHeld;
+}
+
+}; // namespace MCP320xDsp
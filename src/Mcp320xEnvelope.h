@@ -0,0 +1,108 @@
+/**
+ * @file Mcp320xEnvelope.h
+ * @author Patrick Rogalla <patrick@labfruits.com>
+ *
+ * Envelope follower and peak hold for MCP320x sample streams.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+namespace MCP320xDsp {
+
+/**
+ * Envelope follower with peak hold for a single channel. The signal
+ * is rectified around its offset and smoothed with separate attack and
+ * decay time constants, given as power of 2 shifts (a shift of n
+ * corresponds to a time constant of about 2^n samples). The envelope
+ * is published decimated, the peak is held for a configurable time.
+ * The object can be used as sink for MCP320x::readn_to.
+ */
+class Envelope {
+
+public:
+
+  /**
+   * Initiates an envelope follower.
+   * @param [in] attack the attack shift (0 for instant attack).
+   * @param [in] decay the decay shift.
+   * @param [in] decimation number of samples per published envelope value.
+   * @param [in] hold peak hold time in samples.
+   * @param [in] offset the signal offset, midscale by default.
+   */
+  Envelope(uint8_t attack, uint8_t decay, uint16_t decimation,
+    uint32_t hold, uint16_t offset = 2048);
+
+  /**
+   * Resets the envelope and the peak.
+   */
+  void reset();
+
+  /**
+   * Adds the supplied sample.
+   * @param [in] value the sample to add.
+   * @return true if a new decimated envelope value was published.
+   */
+  bool add(uint16_t value)
+  {
+    int16_t x = static_cast<int16_t>(value - mOffset);
+    uint16_t r = (x < 0) ? -x : x;
+    int32_t in = static_cast<int32_t>(r) << 16;
+
+    // envelope in Q16
+    if (in > mEnv) mEnv += (in - mEnv) >> mAttack;
+    else mEnv -= (mEnv - in) >> mDecay;
+
+    // peak hold with timed reset
+    if (r > mPeak) mPeak = r;
+    if (++mHoldCount >= mHold) {
+      mHeld = mPeak;
+      mPeak = 0;
+      mHoldCount = 0;
+    }
+
+    if (++mCount < mDecimation) return false;
+    mCount = 0;
+    mOut = mEnv >> 16;
+    return true;
+  }
+
+  /**
+   * Adds the supplied sample, allows the use as sink.
+   * @param [in] value the sample to add.
+   */
+  void operator()(uint16_t value)
+  {
+    add(value);
+  }
+
+  /**
+   * Returns the last published envelope value.
+   * @return the envelope amplitude in LSB.
+   */
+  uint16_t getEnvelope() const;
+
+  /**
+   * Returns the held peak, the highest rectified sample within the
+   * current and the last completed hold period.
+   * @return the peak amplitude in LSB.
+   */
+  uint16_t getPeak() const;
+
+private:
+
+  uint8_t mAttack;
+  uint8_t mDecay;
+  uint16_t mDecimation;
+  uint32_t mHold;
+  uint16_t mOffset;
+  int32_t mEnv;
+  uint16_t mOut;
+  uint16_t mCount;
+  uint16_t mPeak;
+  uint16_t mHeld;
+  uint32_t mHoldCount;
+};
+
+}; // namespace MCP320xDsp
@@ -0,0 +1,111 @@
+/**
+ * @file Mcp320xFft.h
+ * @author Patrick Rogalla <patrick@labfruits.com>
+ *
+ * Fixed point FFT spectrum stage for captured MCP320x sample blocks.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+namespace MCP320xDsp {
+
+/**
+ * In place radix-2 FFT in Q15 fixed point for captured sample blocks
+ * of 4 to 4096 points. The raw 12 bit samples are windowed and
+ * transformed without any floating point conversion. Every stage is
+ * scaled by 1/2 to prevent overflows, the resulting spectrum is
+ * scaled by 1/N.
+ */
+class Fft {
+
+public:
+
+  /** Maximum transform size. */
+  static const uint16_t kMaxSize = 4096;
+
+  /**
+   * Defines the window function applied before the transform.
+   */
+  enum Window {
+    RECTANGULAR,  /**< no window */
+    HANN          /**< Hann window */
+  };
+
+  /**
+   * Defines a spectral peak.
+   */
+  struct Peak {
+    uint16_t bin;        /**< frequency bin */
+    uint16_t magnitude;  /**< bin magnitude */
+  };
+
+  /**
+   * Initiates a FFT of the supplied size.
+   * @param [in] n the transform size, a power of 2 between 4 and 4096.
+   */
+  explicit Fft(uint16_t n);
+
+  /**
+   * Prepares the raw samples for the transform. Removes the DC offset,
+   * scales the 12 bit samples to Q15 and applies the window function.
+   * @param [in,out] re array of N raw samples.
+   * @param [in] w the window function.
+   */
+  void window(int16_t *re, Window w) const;
+
+  /**
+   * Performs the in place complex transform.
+   * @param [in,out] re array of N real parts.
+   * @param [in,out] im array of N imaginary parts.
+   */
+  void transform(int16_t *re, int16_t *im) const;
+
+  /**
+   * Calculates the magnitude spectrum of a transformed block and
+   * stores it in the first N/2 elements of the real part array.
+   * @param [in,out] re array of N real parts.
+   * @param [in] im array of N imaginary parts.
+   */
+  void magnitude(int16_t *re, const int16_t *im) const;
+
+  /**
+   * Finds the bin with the highest magnitude, excluding the DC bin.
+   * @param [in] mag array of N/2 magnitudes.
+   * @return the spectral peak.
+   */
+  Peak peak(const int16_t *mag) const;
+
+  /**
+   * Calculates the magnitude spectrum of the supplied raw samples in
+   * place (window, transform, magnitude) and finds the spectral peak.
+   * @param [in,out] re array of N raw samples, contains the N/2
+   * magnitudes afterwards.
+   * @param [out] im array of N elements used as imaginary part.
+   * @param [in] w the window function.
+   * @return the spectral peak.
+   */
+  Peak spectrum(int16_t *re, int16_t *im, Window w = HANN) const;
+
+  /**
+   * Returns the center frequency of the supplied bin.
+   * @param [in] bin the frequency bin.
+   * @param [in] splFreq the sample frequency in hz.
+   * @return the bin frequency in hz.
+   */
+  uint32_t binFrequency(uint16_t bin, uint32_t splFreq) const;
+
+  /**
+   * Returns the transform size.
+   * @return the number of points.
+   */
+  uint16_t getSize() const;
+
+private:
+
+  uint16_t mSize;
+  uint8_t mBits;
+};
+
+}; // namespace MCP320xDsp
@@ -0,0 +1,182 @@
+/**
+ * @file Mcp320xGoertzel.h
+ * @author Patrick Rogalla <patrick@labfruits.com>
+ *
+ * Goertzel tone detector bank for MCP320x sample streams.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+
+namespace MCP320xDsp {
+
+/**
+ * Bank of Goertzel filters, detecting the amplitude of a fixed set
+ * of tones. The filters run in fixed point on every sample and
+ * produce results every block of N samples. Every tone costs one
+ * multiply per sample. The object can be used as sink for
+ * MCP320x::readn_to.
+ * The 32 bit filter states limit the block size. A tone with
+ * w = 2 * pi * f / fs and the largest sample deviation A from the offset
+ * grows the state by at most A / sin(w) per sample, and by at most A
+ * times the sample count for tones near 0hz. The block size is limited,
+ * so that the states stay below 2^30, e.g. to 16468 samples for 50hz at
+ * 10ksps with midscale offset. Long blocks of low tones are detuned by
+ * the resolution of the Q14 coefficients.
+ * @tparam Tones number of tones to detect.
+ */
+template <uint8_t Tones>
+class Goertzel {
+
+public:
+
+  /** Fractional bits of the filter coefficients. */
+  static const uint8_t kCoeffBits = 14;
+
+  /**
+   * Initiates a Goertzel filter bank.
+   * @param [in] freq array of tone frequencies in hz.
+   * @param [in] splFreq the sample frequency in hz.
+   * @param [in] blockSize number of samples per result, limited to
+   * keep the filter states within 32 bit (see getBlockSize).
+   * @param [in] offset the signal offset removed from every sample,
+   * midscale by default.
+   */
+  Goertzel(const uint32_t (&freq)[Tones], uint32_t splFreq,
+    uint16_t blockSize, uint16_t offset = 2048)
+    : mBlockSize(blockSize)
+    , mOffset(offset)
+  {
+    // largest sample deviation from the offset of a 12 bit ADC
+    float dev = (offset > 2047) ? offset : 4095 - offset;
+    for (uint8_t t = 0; t < Tones; t++) {
+      // 2 * cos(2 * pi * f / fs) in Q14
+      float w = 6.2831853f * freq[t] / splFreq;
+      int32_t q = lroundf(2.0f * cosf(w) * (1 << kCoeffBits));
+      mCoeff[t] = (q > INT16_MAX) ? INT16_MAX : q;
+      mAmplitude[t] = 0;
+
+      // state limit 2^30, the filter step sums up twice the state
+      float limit = 1073741824.0f / dev;
+      float n = fabsf(sinf(w)) * limit;
+      float dc = sqrtf(2 * limit) - 1;
+      if (dc > n) n = dc;
+      if (n < mBlockSize) mBlockSize = (n < 1) ? 1 : n;
+    }
+    reset();
+  }
+
+  /**
+   * Resets the filter states and starts a new block. The results
+   * of the last block are kept.
+   */
+  void reset()
+  {
+    mCount = 0;
+    for (uint8_t t = 0; t < Tones; t++) mS1[t] = mS2[t] = 0;
+  }
+
+  /**
+   * Adds the supplied sample to all filters.
+   * @param [in] value the sample to add.
+   * @return true if a block was completed and new results are available.
+   */
+  bool add(uint16_t value)
+  {
+    int32_t x = static_cast<int32_t>(value) - mOffset;
+
+    for (uint8_t t = 0; t < Tones; t++) {
+      int32_t s0 = x + mul(mS1[t], mCoeff[t]) - mS2[t];
+      mS2[t] = mS1[t];
+      mS1[t] = s0;
+    }
+
+    if (++mCount < mBlockSize) return false;
+
+    for (uint8_t t = 0; t < Tones; t++) mAmplitude[t] = amplitude(t);
+    reset();
+    return true;
+  }
+
+  /**
+   * Adds the supplied sample, allows the use as sink.
+   * @param [in] value the sample to add.
+   */
+  void operator()(uint16_t value)
+  {
+    add(value);
+  }
+
+  /**
+   * Returns the amplitude of the supplied tone from the last
+   * completed block.
+   * @param [in] tone the tone index.
+   * @return the tone amplitude in LSB.
+   */
+  uint16_t getAmplitude(uint8_t tone) const
+  {
+    return mAmplitude[tone];
+  }
+
+  /**
+   * Returns the number of samples per result.
+   * @return the block size, less than requested if the filter states
+   * could exceed 32 bit.
+   */
+  uint16_t getBlockSize() const
+  {
+    return mBlockSize;
+  }
+
+private:
+
+  /**
+   * Multiplies a filter state with a Q14 coefficient. On AVR the
+   * product is split into two 16 bit multiplies, to avoid a 64 bit
+   * multiplication per sample.
+   * @param [in] s the filter state.
+   * @param [in] c the coefficient.
+   * @return the Q14 product.
+   */
+  static int32_t mul(int32_t s, int16_t c)
+  {
+#if defined(__AVR__)
+    int32_t hi = static_cast<int32_t>(static_cast<int16_t>(s >> 16)) * c;
+    int32_t lo = static_cast<int32_t>(static_cast<uint16_t>(s)) * c;
+    return hi * (1 << (16 - kCoeffBits)) + (lo >> kCoeffBits);
+#else
+    return (static_cast<int64_t>(s) * c) >> kCoeffBits;
+#endif
+  }
+
+  /**
+   * Calculates the tone amplitude of the current block.
+   * @param [in] t the tone index.
+   * @return the tone amplitude in LSB.
+   */
+  uint16_t amplitude(uint8_t t) const
+  {
+    int64_t s1 = mS1[t];
+    int64_t s2 = mS2[t];
+    // squared magnitude, the states are below 2^30
+    int64_t p = s1 * s1 + s2 * s2 - ((s1 * mCoeff[t]) >> kCoeffBits) * s2;
+    if (p <= 0) return 0;
+
+    // amplitude = 2 * sqrt(p) / N
+    return 2.0f * sqrtf(static_cast<float>(p)) / mBlockSize + 0.5f;
+  }
+
+private:
+
+  uint16_t mBlockSize;
+  uint16_t mOffset;
+  uint16_t mCount;
+  int16_t mCoeff[Tones];
+  int32_t mS1[Tones];
+  int32_t mS2[Tones];
+  uint16_t mAmplitude[Tones];
+};
+
+}; // namespace MCP320xDsp
@@ -0,0 +1,47 @@
+/**
+ * @file Mcp320xHooks.h
+ * @author Patrick Rogalla <patrick@labfruits.com>
+ *
+ * Compile time trace hooks for the MCP320x acquisition path.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+namespace MCP320xHooks {
+
+/**
+ * Default hook policy, all hooks are empty and compile away.
+ * A custom policy implements the same static functions and is passed
+ * as second template argument to MCP320x, e.g. to count conversions,
+ * toggle a debug pin or fill a trace buffer. Classes using a custom
+ * policy must include Mcp320xImpl.h instead of Mcp320x.h.
+ */
+struct None {
+
+  /**
+   * Called before every conversion.
+   */
+  static void onSampleStart() {}
+
+  /**
+   * Called after every conversion.
+   * @param [in] value the converted raw value.
+   */
+  static void onSampleDone(uint16_t value) { (void)value; }
+
+  /**
+   * Called when the predicate of a triggered read became true and
+   * sampling starts.
+   */
+  static void onTriggerArmed() {}
+
+  /**
+   * Called when a rate limited read cannot reach the requested
+   * sample frequency.
+   */
+  static void onOverrun() {}
+};
+
+}; // namespace MCP320xHooks
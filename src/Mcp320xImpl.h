@@ -0,0 +1,533 @@
+/**
+ * @file Mcp320xImpl.h
+ * @author  Patrick Rogalla <patrick@labfruits.com>
+ *
+ * Implementation of the MCP320x interface. The default configurations
+ * are instantiated by the library, include this file instead of
+ * Mcp320x.h to instantiate a configuration with custom hooks.
+ */
+#pragma once
+
+#include "Mcp320x.h"
+#include "Mcp320xClock.h"
+#include "Mcp320xCounters.h"
+#include "Mcp320xJitter.h"
+#include "Mcp320xPhases.h"
+
+// divide n by d and round to next integer
+#define div_round(n,d) (((n) + ((d) >> 1)) / (d))
+
+namespace MCP320xTypes {
+
+/**
+ * Returns whether the chip requires a command.
+ */
+constexpr bool hasCommand(MCP3201::Channel) { return false; }
+constexpr bool hasCommand(MCP3202::Channel) { return true; }
+constexpr bool hasCommand(MCP3204::Channel) { return true; }
+constexpr bool hasCommand(MCP3208::Channel) { return true; }
+
+/**
+ * Returns the command for the supplied channel.
+ */
+inline uint16_t command(MCP3201::Channel)
+{
+  // no command required
+  return 0;
+}
+
+inline uint16_t command(MCP3202::Channel ch)
+{
+  // base command structure
+  // 0b00000001cc100000
+  // c: channel config
+  return static_cast<uint16_t>((0x0120 | (ch << 6)));
+}
+
+inline uint16_t command(MCP3204::Channel ch)
+{
+  // base command structure
+  // 0b000001cxcc000000
+  // c: channel config
+  return static_cast<uint16_t>((0x0400 | (ch << 6)));
+}
+
+inline uint16_t command(MCP3208::Channel ch)
+{
+  // base command structure
+  // 0b000001cccc000000
+  // c: channel config
+  return static_cast<uint16_t>((0x0400 | (ch << 6)));
+}
+
+}; // namespace MCP320xTypes
+
+template <typename T, typename H>
+MCP320x<T, H>::MCP320x(uint16_t vref, uint8_t csPin, SPIClass *spi)
+  : mVref(vref)
+  , mCsPin(csPin)
+  , mCalCh(0)
+  , mSplSpeed(0)
+  , mSpi(spi)
+  , mManaged(false)
+  , mDepth(0)
+  , mCounters(nullptr) {}
+
+template <typename T, typename H>
+MCP320x<T, H>::MCP320x(uint16_t vref, uint8_t csPin)
+  : MCP320x(vref, csPin, &SPI) {}
+
+template <typename T, typename H>
+void MCP320x<T, H>::calibrate(Channel ch)
+{
+  mSplSpeed = testSplSpeed(ch, 256);
+  mCalCh = static_cast<uint8_t>(ch);
+}
+
+template <typename T, typename H>
+bool MCP320x<T, H>::getCalibration(uint32_t spiClock, uint32_t boardId,
+  MCP320xTypes::Calibration &cal) const
+{
+  if (!mSplSpeed) return false;
+
+  cal.channel = mCalCh;
+  cal.spiClock = spiClock;
+  cal.boardId = boardId;
+  cal.splSpeed = mSplSpeed;
+  cal.seal();
+
+  return true;
+}
+
+template <typename T, typename H>
+bool MCP320x<T, H>::setCalibration(Channel ch, uint32_t spiClock,
+  uint32_t boardId, const MCP320xTypes::Calibration &cal)
+{
+  if (!cal.matches(spiClock, boardId, static_cast<uint8_t>(ch)))
+    return false;
+
+  // the profile must agree with a short speed test
+  uint32_t splSpeed = testSplSpeed(ch, 16);
+  uint32_t diff = (splSpeed > cal.splSpeed) ?
+    splSpeed - cal.splSpeed : cal.splSpeed - splSpeed;
+  if (diff > (cal.splSpeed >> 3)) return false;
+
+  mSplSpeed = cal.splSpeed;
+  mCalCh = cal.channel;
+
+  return true;
+}
+
+template <typename T, typename H>
+uint32_t MCP320x<T, H>::autotune(Channel ch, Channel ref, uint32_t minClock,
+  uint32_t maxClock, uint16_t tolerance)
+{
+  // steps run in own transactions, also without managed settings
+  bool managed = mManaged;
+  mManaged = true;
+
+  uint32_t best = 0;
+  uint16_t baseline = 0;
+  uint32_t clock = minClock;
+
+  for (;;) {
+    // skip requests, which round to the last tested clock
+    uint32_t effective = toSpiClock(clock);
+    if (effective != best) {
+      setSpiClock(effective);
+
+      uint16_t mean;
+      bool valid;
+      {
+        Transaction tr(this);
+        valid = testClock(ch, ref, tolerance, mean);
+      }
+      if (!valid) break;
+      if (!best) {
+        baseline = mean;
+      } else {
+        uint16_t diff = (mean > baseline) ? mean - baseline : baseline - mean;
+        if (diff > tolerance) break;
+      }
+      best = effective;
+    }
+
+    // next step, at least 1hz
+    if (clock >= maxClock) break;
+    uint32_t step = (clock >> 2) ? (clock >> 2) : 1;
+    clock = (maxClock - clock > step) ? clock + step : maxClock;
+  }
+
+  setSpiClock(best ? best : toSpiClock(minClock));
+  if (best) calibrate(ch);
+  else mSplSpeed = 0;
+  mManaged = managed;
+
+  return best;
+}
+
+template <typename T, typename H>
+uint16_t MCP320x<T, H>::read(Channel ch) const
+{
+  Transaction tr(this);
+  return execute(createCmd(ch));
+}
+
+template <typename T, typename H>
+bool MCP320x<T, H>::read_checked(Channel ch, uint16_t &value) const
+{
+  Transaction tr(this);
+  return executeChecked(createCmd(ch), value);
+}
+
+template <typename T, typename H>
+uint32_t MCP320x<T, H>::testSplSpeed(Channel ch) const
+{
+  return testSplSpeed(ch, 64);
+}
+
+template <typename T, typename H>
+uint32_t MCP320x<T, H>::testSplSpeed(Channel ch, uint16_t num) const
+{
+  Transaction tr(this);
+  return measure(createCmd(ch), num, 0);
+}
+
+template <typename T, typename H>
+uint32_t MCP320x<T, H>::testSplSpeed(Channel ch, uint16_t num, uint32_t splFreq)
+{
+  Transaction tr(this);
+  // required delay
+  uint16_t delay = getSplDelay(ch, splFreq);
+
+  return measure(createCmd(ch), num, delay);
+}
+
+template <typename T, typename H>
+void MCP320x<T, H>::testSplJitter(Channel ch, uint16_t num,
+  MCP320xProfile::Jitter &jitter) const
+{
+  Transaction tr(this);
+  profile(createCmd(ch), num, 0, jitter);
+}
+
+template <typename T, typename H>
+void MCP320x<T, H>::testSplJitter(Channel ch, uint16_t num, uint32_t splFreq,
+  MCP320xProfile::Jitter &jitter)
+{
+  Transaction tr(this);
+  // required delay
+  uint16_t delay = getSplDelay(ch, splFreq);
+
+  profile(createCmd(ch), num, delay, jitter);
+}
+
+template <typename T, typename H>
+void MCP320x<T, H>::setSpiSettings(const SPISettings &settings)
+{
+  mSettings = settings;
+  mManaged = true;
+}
+
+template <typename T, typename H>
+void MCP320x<T, H>::beginTransaction() const
+{
+  if (mManaged && !mDepth++) mSpi->beginTransaction(mSettings);
+}
+
+template <typename T, typename H>
+void MCP320x<T, H>::endTransaction() const
+{
+  if (mManaged && mDepth && !--mDepth) mSpi->endTransaction();
+}
+
+template <typename T, typename H>
+void MCP320x<T, H>::setCounters(MCP320xProfile::Counters *counters)
+{
+  mCounters = counters;
+}
+
+template <typename T, typename H>
+MCP320xProfile::Counters *MCP320x<T, H>::getCounters() const
+{
+  return mCounters;
+}
+
+template <typename T, typename H>
+uint32_t MCP320x<T, H>::getSplSpeed() const
+{
+  return mSplSpeed;
+}
+
+template <typename T, typename H>
+uint16_t MCP320x<T, H>::toAnalog(uint16_t raw) const
+{
+  return (static_cast<uint32_t>(raw) * mVref) / (kRes - 1);
+}
+
+template <typename T, typename H>
+uint16_t MCP320x<T, H>::toDigital(uint16_t val) const
+{
+  return (static_cast<uint32_t>(val) * (kRes - 1)) / mVref;
+}
+
+template <typename T, typename H>
+uint16_t MCP320x<T, H>::getVref() const
+{
+  return mVref;
+}
+
+template <typename T, typename H>
+uint16_t MCP320x<T, H>::getAnalogRes() const
+{
+  return (static_cast<uint32_t>(mVref) * 1000) / (kRes - 1);
+}
+
+template <typename T, typename H>
+uint16_t MCP320x<T, H>::getSplDelay(Channel ch, uint32_t splFreq)
+{
+  // requested sampling period (ns)
+  uint32_t splTime = div_round(1000000000, splFreq);
+
+  // measure speed if uncalibrated
+  if (!mSplSpeed) calibrate(ch);
+
+  // sampling already slower than requested
+  if (splTime <= mSplSpeed) {
+    H::onOverrun();
+    if (mCounters) mCounters->overrun();
+    return 0;
+  }
+
+  // calculate delay in us
+  uint32_t delay = (splTime - mSplSpeed) / 1000;
+  return (delay > UINT16_MAX) ? UINT16_MAX : static_cast<uint16_t>(delay);
+}
+
+template <typename T, typename H>
+uint32_t MCP320x<T, H>::measure(Command<Channel> cmd, uint16_t num,
+  uint16_t delay) const
+{
+  uint64_t elapsed = 0;
+
+  MCP320xClock::begin();
+  // start time
+  uint32_t t1 = MCP320xClock::ticks();
+  // perform sampling
+  for (uint16_t i = 0; i < num; i++) {
+    execute(cmd);
+    if (delay) delayMicroseconds(delay);
+    // accumulate wrapping high resolution timestamps per sample
+    if (MCP320xClock::kHighRes) {
+      uint32_t t2 = MCP320xClock::ticks();
+      elapsed += t2 - t1;
+      t1 = t2;
+    }
+  }
+  // stop time
+  if (!MCP320xClock::kHighRes) elapsed = MCP320xClock::ticks() - t1;
+
+  // return average sampling speed
+  return div_round(MCP320xClock::toNs(elapsed), num);
+}
+
+template <typename T, typename H>
+void MCP320x<T, H>::profile(Command<Channel> cmd, uint16_t num, uint16_t delay,
+  MCP320xProfile::Jitter &jitter) const
+{
+  // center the histogram around the average interval
+  jitter.begin(measure(cmd, 16, delay));
+
+  uint32_t t1 = MCP320xClock::ticks();
+  for (uint16_t i = 0; i < num; i++) {
+    execute(cmd);
+    if (delay) delayMicroseconds(delay);
+    uint32_t t2 = MCP320xClock::ticks();
+    jitter.add(t2 - t1);
+    t1 = t2;
+  }
+}
+
+template <typename T, typename H>
+void MCP320x<T, H>::endBlock(Timing &t, uint32_t num) const
+{
+  if (mCounters) mCounters->block(num, t.elapsed());
+}
+
+template <typename T, typename H>
+void MCP320x<T, H>::endTrigger(Timing &t) const
+{
+  if (mCounters) mCounters->trigger(t.elapsed());
+}
+
+template <typename T, typename H>
+typename MCP320x<T, H>::SpiData MCP320x<T, H>::createCmd(Channel ch)
+{
+  Command<Channel> cmd;
+  cmd.value = MCP320xTypes::command(ch);
+  return cmd;
+}
+
+template <typename T, typename H>
+uint16_t MCP320x<T, H>::execute(Command<Channel> cmd) const
+{
+  const bool hasCmd = MCP320xTypes::hasCommand(Channel());
+
+  H::onSampleStart();
+  uint16_t value = toValue(frame(cmd));
+  if (mCounters) mCounters->conversion(hasCmd ? 3 : 2);
+  H::onSampleDone(value);
+  return value;
+}
+
+template <typename T, typename H>
+bool MCP320x<T, H>::executeChecked(Command<Channel> cmd,
+  uint16_t &value) const
+{
+  const bool hasCmd = MCP320xTypes::hasCommand(Channel());
+
+  H::onSampleStart();
+  SpiData data = frame(cmd);
+  value = toValue(data);
+  if (mCounters) mCounters->conversion(hasCmd ? 3 : 2);
+  H::onSampleDone(value);
+
+  if (isValid(data)) return true;
+  if (mCounters) mCounters->frameError();
+  return false;
+}
+
+template <typename T, typename H>
+typename MCP320x<T, H>::SpiData MCP320x<T, H>::frame(
+  Command<Channel> cmd) const
+{
+  return MCP320xTypes::hasCommand(Channel()) ? transfer(cmd) : transfer();
+}
+
+template <typename T, typename H>
+bool MCP320x<T, H>::isValid(SpiData frame)
+{
+  if (MCP320xTypes::hasCommand(Channel())) {
+    // |x|x|x|null|11|10|9|8| |7|6|5|4|3|2|1|0|
+    return !(frame.hiByte & 0x10);
+  }
+
+  // |x|x|null|11|10|9|8|7| |6|5|4|3|2|1|0|1|
+  return !(frame.hiByte & 0x20) &&
+    ((frame.loByte ^ (frame.loByte >> 2)) & 0x01) == 0;
+}
+
+template <typename T, typename H>
+uint16_t MCP320x<T, H>::toValue(SpiData frame)
+{
+  if (MCP320xTypes::hasCommand(Channel())) return frame.value & 0x0FFF;
+
+  // correct bit offset
+  return (frame.value & 0x1FFF) >> 1;
+}
+
+template <typename T, typename H>
+bool MCP320x<T, H>::testClock(Channel ch, Channel ref, uint16_t tolerance,
+  uint16_t &mean) const
+{
+  const uint8_t num = 32;
+
+  auto cmd = createCmd(ch);
+  for (uint8_t i = 0; i < num; i++) {
+    if (!isValid(frame(cmd))) return false;
+  }
+
+  uint16_t min = UINT16_MAX;
+  uint16_t max = 0;
+  uint32_t sum = 0;
+
+  cmd = createCmd(ref);
+  for (uint8_t i = 0; i < num; i++) {
+    SpiData data = frame(cmd);
+    if (!isValid(data)) return false;
+    uint16_t value = toValue(data);
+    if (value < min) min = value;
+    if (value > max) max = value;
+    sum += value;
+  }
+
+  mean = div_round(sum, num);
+  return (max - min) <= tolerance;
+}
+
+template <typename T, typename H>
+void MCP320x<T, H>::setSpiClock(uint32_t clock)
+{
+  mSettings = SPISettings(clock, MSBFIRST, SPI_MODE0);
+  if (!mManaged || !mDepth) return;
+
+  mSpi->endTransaction();
+  mSpi->beginTransaction(mSettings);
+}
+
+template <typename T, typename H>
+uint32_t MCP320x<T, H>::toSpiClock(uint32_t clock)
+{
+#if defined(__AVR__)
+  // SPISettings selects the fastest divider 2..128 not above the clock
+  uint32_t effective = F_CPU / 2;
+  for (uint8_t div = 2; div < 128 && effective > clock; div <<= 1)
+    effective >>= 1;
+  return effective;
+#else
+  return clock;
+#endif
+}
+
+template <typename T, typename H>
+typename MCP320x<T, H>::SpiData MCP320x<T, H>::transfer() const
+{
+  SpiData adc;
+  MCP320X_PHASE_START();
+
+  // activate ADC with chip select
+  digitalWrite(mCsPin, LOW);
+  MCP320X_PHASE(CS_ASSERT);
+
+  // receive first(msb) 5 bits
+  adc.hiByte = mSpi->transfer(0x00);
+  MCP320X_PHASE(TRANSFER_0);
+  // receive last(lsb) 8 bits
+  adc.loByte = mSpi->transfer(0x00);
+  MCP320X_PHASE(TRANSFER_1);
+
+  // deactivate ADC with slave select
+  digitalWrite(mCsPin, HIGH);
+  MCP320X_PHASE_END(CS_DEASSERT);
+
+  return adc;
+}
+
+template <typename T, typename H>
+typename MCP320x<T, H>::SpiData MCP320x<T, H>::transfer(SpiData cmd) const
+{
+  SpiData adc;
+  MCP320X_PHASE_START();
+
+  // activate ADC with chip select
+  digitalWrite(mCsPin, LOW);
+  MCP320X_PHASE(CS_ASSERT);
+
+  // send first command byte
+  mSpi->transfer(cmd.hiByte);
+  MCP320X_PHASE(TRANSFER_0);
+  // send second command byte and receive first(msb) 4 bits
+  adc.hiByte = mSpi->transfer(cmd.loByte);
+  MCP320X_PHASE(TRANSFER_1);
+  // receive last(lsb) 8 bits
+  adc.loByte = mSpi->transfer(0x00);
+  MCP320X_PHASE(TRANSFER_2);
+
+  // deactivate ADC with slave select
+  digitalWrite(mCsPin, HIGH);
+  MCP320X_PHASE_END(CS_DEASSERT);
+
+  return adc;
+}
+
+#undef div_round
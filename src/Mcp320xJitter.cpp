@@ -0,0 +1,90 @@
+/**
+ * @file Mcp320xJitter.cpp
+ * @author  Patrick Rogalla <patrick@labfruits.com>
+ */
+#include "Mcp320xJitter.h"
+#include "Mcp320xClock.h"
+
+namespace MCP320xProfile {
+
+Jitter::Jitter(uint32_t binWidth)
+  : mShift(0)
+{
+  // nearest power of 2 ticks
+  uint32_t w = MCP320xClock::fromNs(binWidth);
+  while (mShift < 31 && (2UL << mShift) <= w + (w >> 1)) mShift++;
+  begin(0);
+}
+
+void Jitter::begin(uint32_t center)
+{
+  uint32_t c = MCP320xClock::fromNs(center);
+  uint32_t half = static_cast<uint32_t>(kBins / 2) << mShift;
+
+  mOrigin = (c > half) ? c - half : 0;
+  mCount = 0;
+  mMin = UINT32_MAX;
+  mMax = 0;
+  mBelow = 0;
+  mAbove = 0;
+  for (uint8_t i = 0; i < kBins; i++) mBins[i] = 0;
+}
+
+uint32_t Jitter::getCount() const
+{
+  return mCount;
+}
+
+uint32_t Jitter::getOutliers() const
+{
+  return mBelow + mAbove;
+}
+
+uint32_t Jitter::getMin() const
+{
+  return mCount ? MCP320xClock::toNs(mMin) : 0;
+}
+
+uint32_t Jitter::getMax() const
+{
+  return MCP320xClock::toNs(mMax);
+}
+
+uint32_t Jitter::getPercentile(uint8_t p) const
+{
+  if (!mCount) return 0;
+
+  // number of intervals at or below the percentile
+  uint32_t target = (static_cast<uint64_t>(mCount) * p + 99) / 100;
+  uint32_t sum = mBelow;
+  if (sum >= target) return getMin();
+
+  for (uint8_t i = 0; i < kBins; i++) {
+    sum += mBins[i];
+    if (sum < target) continue;
+    // the bin end, within the recorded range
+    uint32_t end = getBinStart(i) + getBinWidth();
+    uint32_t min = getMin();
+    uint32_t max = getMax();
+    return (end < min) ? min : (end > max) ? max : end;
+  }
+
+  return getMax();
+}
+
+uint32_t Jitter::getBinWidth() const
+{
+  return MCP320xClock::toNs(1ULL << mShift);
+}
+
+uint32_t Jitter::getBinStart(uint8_t bin) const
+{
+  return MCP320xClock::toNs(mOrigin + (static_cast<uint64_t>(bin) << mShift));
+}
+
+uint32_t Jitter::getBinCount(uint8_t bin) const
+{
+  return mBins[bin];
+}
+
+}; // namespace MCP320xProfile
@@ -0,0 +1,125 @@
+/**
+ * @file Mcp320xJitter.h
+ * @author Patrick Rogalla <patrick@labfruits.com>
+ *
+ * Sampling interval histogram for jitter profiling.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+namespace MCP320xProfile {
+
+/**
+ * Fixed bin histogram of sampling intervals with constant memory.
+ * Intervals are recorded in clock ticks (see Mcp320xClock.h) to keep
+ * the recording cost low, the bin width is rounded to a power of 2
+ * ticks. Intervals outside of the histogram range are counted as
+ * outliers. Filled by MCP320x::testSplJitter.
+ */
+class Jitter {
+
+public:
+
+  /** Number of histogram bins. */
+  static const uint8_t kBins = 32;
+
+  /**
+   * Initiates an empty histogram.
+   * @param [in] binWidth the requested bin width in ns.
+   */
+  explicit Jitter(uint32_t binWidth);
+
+  /**
+   * Resets the histogram and centers the bins around the supplied
+   * interval.
+   * @param [in] center the expected interval in ns.
+   */
+  void begin(uint32_t center);
+
+  /**
+   * Records the supplied interval.
+   * @param [in] t the interval in clock ticks.
+   */
+  void add(uint32_t t)
+  {
+    mCount++;
+    if (t < mMin) mMin = t;
+    if (t > mMax) mMax = t;
+
+    if (t < mOrigin) {
+      mBelow++;
+      return;
+    }
+    uint32_t bin = (t - mOrigin) >> mShift;
+    if (bin < kBins) mBins[bin]++;
+    else mAbove++;
+  }
+
+  /**
+   * Returns the number of recorded intervals.
+   * @return the number of intervals.
+   */
+  uint32_t getCount() const;
+
+  /**
+   * Returns the number of intervals outside of the histogram range.
+   * @return the number of outliers.
+   */
+  uint32_t getOutliers() const;
+
+  /**
+   * Returns the shortest recorded interval.
+   * @return the interval in ns.
+   */
+  uint32_t getMin() const;
+
+  /**
+   * Returns the longest recorded interval.
+   * @return the interval in ns.
+   */
+  uint32_t getMax() const;
+
+  /**
+   * Returns the interval below which the supplied percentage of all
+   * intervals lies, with the resolution of one bin and limited to the
+   * recorded minimum and maximum.
+   * @param [in] p the percentile (0..100).
+   * @return the interval in ns.
+   */
+  uint32_t getPercentile(uint8_t p) const;
+
+  /**
+   * Returns the effective bin width.
+   * @return the bin width in ns.
+   */
+  uint32_t getBinWidth() const;
+
+  /**
+   * Returns the lower bound of the supplied bin.
+   * @param [in] bin the bin index.
+   * @return the interval in ns.
+   */
+  uint32_t getBinStart(uint8_t bin) const;
+
+  /**
+   * Returns the number of intervals in the supplied bin.
+   * @param [in] bin the bin index.
+   * @return the number of intervals.
+   */
+  uint32_t getBinCount(uint8_t bin) const;
+
+private:
+
+  uint8_t mShift;
+  uint32_t mOrigin;
+  uint32_t mCount;
+  uint32_t mMin;
+  uint32_t mMax;
+  uint32_t mBelow;
+  uint32_t mAbove;
+  uint32_t mBins[kBins];
+};
+
+}; // namespace MCP320xProfile
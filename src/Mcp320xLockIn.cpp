@@ -0,0 +1,68 @@
+/**
+ * @file Mcp320xLockIn.cpp
+ * @author  Patrick Rogalla <patrick@labfruits.com>
+ */
+#include <math.h>
+#include "Mcp320xLockIn.h"
+
+namespace MCP320xDsp {
+
+LockIn::LockIn(uint8_t pin, uint16_t period, uint16_t periods,
+  uint16_t offset)
+  : mPin(pin)
+  , mPeriod(period)
+  , mPeriods(periods)
+  , mOffset(offset)
+  , mPhase(0)
+  , mQuad(period - (period >> 2))
+  , mCount(0)
+  , mSumI(0)
+  , mSumQ(0)
+  , mI(0)
+  , mQ(0) {}
+
+void LockIn::reset()
+{
+  mPhase = 0;
+  mQuad = mPeriod - (mPeriod >> 2);
+  mCount = 0;
+  mSumI = mSumQ = 0;
+  mI = mQ = 0;
+  digitalWrite(mPin, HIGH);
+}
+
+int32_t LockIn::getInPhase() const
+{
+  return mI;
+}
+
+int32_t LockIn::getQuadrature() const
+{
+  return mQ;
+}
+
+uint32_t LockIn::getAmplitude() const
+{
+  float i = mI;
+  float q = mQ;
+  return sqrtf(i * i + q * q) + 0.5f;
+}
+
+float LockIn::getPhase() const
+{
+  return atan2f(mQ, mI) * 57.29578f;
+}
+
+void LockIn::complete()
+{
+  int32_t n = static_cast<int32_t>(mPeriod) * mPeriods;
+
+  // mean demodulated values in 1/256 LSB
+  mI = (static_cast<int64_t>(mSumI) * 256) / n;
+  mQ = (static_cast<int64_t>(mSumQ) * 256) / n;
+
+  mCount = 0;
+  mSumI = mSumQ = 0;
+}
+
+}; // namespace MCP320xDsp
@@ -0,0 +1,139 @@
+/**
+ * @file Mcp320xLockIn.h
+ * @author Patrick Rogalla <patrick@labfruits.com>
+ *
+ * Lock-in (synchronous demodulation) measurement for MCP320x
+ * sample streams.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <Arduino.h>
+
+namespace MCP320xDsp {
+
+/**
+ * Lock-in amplifier for a single channel. The stage drives a square
+ * wave excitation pin in step with the sampling, one excitation period
+ * lasts a fixed number of samples. Every sample is multiplied with an
+ * in phase and a quadrature reference (+1/-1) and integrated over a
+ * whole number of excitation periods, which rejects the DC offset and
+ * recovers amplitude and phase of the response far below the ADC
+ * resolution.
+ * The stage is used as sink for MCP320x::readn_to, which calls it
+ * after every conversion. The excitation pin must be already
+ * configured as output.
+ */
+class LockIn {
+
+public:
+
+  /**
+   * Initiates a lock-in stage.
+   * @param [in] pin the excitation pin number.
+   * @param [in] period excitation period in samples, a multiple of 4.
+   * @param [in] periods integration time in excitation periods. At most
+   * 2^19 samples can be integrated.
+   * @param [in] offset the signal offset, midscale by default.
+   */
+  LockIn(uint8_t pin, uint16_t period, uint16_t periods,
+    uint16_t offset = 2048);
+
+  /**
+   * Resets the integrators and starts a new excitation period by
+   * driving the excitation pin high. Must be called before sampling,
+   * as the constructor doesn't drive the pin.
+   */
+  void reset();
+
+  /**
+   * Demodulates the supplied sample and sets the excitation for
+   * the next sample.
+   * @param [in] value the sample converted with the current excitation.
+   * @return true if an integration was completed and new results
+   * are available.
+   */
+  bool add(uint16_t value)
+  {
+    int32_t x = static_cast<int32_t>(value) - mOffset;
+    uint16_t half = mPeriod >> 1;
+
+    // square wave references, quadrature lags by a quarter period
+    mSumI += (mPhase < half) ? x : -x;
+    mSumQ += (mQuad < half) ? x : -x;
+
+    if (++mQuad == mPeriod) mQuad = 0;
+    if (++mPhase == half) {
+      digitalWrite(mPin, LOW);
+    } else if (mPhase == mPeriod) {
+      // toggle the excitation on half period boundaries
+      mPhase = 0;
+      digitalWrite(mPin, HIGH);
+      if (++mCount == mPeriods) {
+        complete();
+        return true;
+      }
+    }
+
+    return false;
+  }
+
+  /**
+   * Demodulates the supplied sample, allows the use as sink.
+   * @param [in] value the sample to add.
+   */
+  void operator()(uint16_t value)
+  {
+    add(value);
+  }
+
+  /**
+   * Returns the in phase component of the last integration.
+   * @return the in phase component in 1/256 LSB.
+   */
+  int32_t getInPhase() const;
+
+  /**
+   * Returns the quadrature component of the last integration.
+   * @return the quadrature component in 1/256 LSB.
+   */
+  int32_t getQuadrature() const;
+
+  /**
+   * Returns the response amplitude of the last integration.
+   * @return the amplitude in 1/256 LSB.
+   */
+  uint32_t getAmplitude() const;
+
+  /**
+   * Returns the response phase of the last integration relative
+   * to the excitation.
+   * @return the phase in degrees (-180..180).
+   */
+  float getPhase() const;
+
+private:
+
+  /**
+   * Publishes the results of the current integration and
+   * starts a new one.
+   */
+  void complete();
+
+private:
+
+  uint8_t mPin;
+  uint16_t mPeriod;
+  uint16_t mPeriods;
+  uint16_t mOffset;
+  uint16_t mPhase;
+  uint16_t mQuad;
+  uint16_t mCount;
+  int32_t mSumI;
+  int32_t mSumQ;
+  int32_t mI;
+  int32_t mQ;
+};
+
+}; // namespace MCP320xDsp
@@ -0,0 +1,316 @@
+/**
+ * @file Mcp320xLogger.h
+ * @author Patrick Rogalla <patrick@labfruits.com>
+ *
+ * Double buffered block logger, which persists samples in large
+ * aligned writes to a storage backend.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <Arduino.h>
+#include "Mcp320xClock.h"
+
+namespace MCP320xLog {
+
+/**
+ * Storage backend for file like objects with a write(data, len) method
+ * returning the number of written bytes, e.g. a SD or SdFat File, a
+ * SerialFlash or LittleFS file.
+ * @tparam F the file type.
+ */
+template <typename F>
+class FileStorage {
+
+public:
+
+  /**
+   * Initiates a file storage.
+   * @param [in] file the open file to write to.
+   */
+  explicit FileStorage(F &file)
+    : mFile(file) {}
+
+  /**
+   * Writes the supplied block.
+   * @param [in] data the block data.
+   * @param [in] len the block length in bytes.
+   * @return true if all bytes were written.
+   */
+  bool write(const uint8_t *data, uint16_t len)
+  {
+    return mFile.write(data, len) == len;
+  }
+
+private:
+
+  F &mFile;
+};
+
+/**
+ * Storage backend for raw SPI flash with a writeBuffer(addr, data, len)
+ * method, e.g. Adafruit_SPIFlash. The blocks are written sequentially
+ * from the start address, which should be aligned to the block size.
+ * The flash must be erased.
+ * @tparam Flash the flash type.
+ */
+template <typename Flash>
+class FlashStorage {
+
+public:
+
+  /**
+   * Initiates a flash storage.
+   * @param [in] flash the flash to write to.
+   * @param [in] addr the start address.
+   * @param [in] size the available size in bytes.
+   */
+  FlashStorage(Flash &flash, uint32_t addr, uint32_t size)
+    : mFlash(flash)
+    , mAddr(addr)
+    , mEnd(addr + size) {}
+
+  /**
+   * Writes the supplied block at the next address. The address only
+   * advances if the block was written, the next block is written to
+   * the address of a failed one.
+   * @param [in] data the block data.
+   * @param [in] len the block length in bytes.
+   * @return true if all bytes were written, false if failed or full.
+   */
+  bool write(const uint8_t *data, uint16_t len)
+  {
+    if (mEnd - mAddr < len) return false;
+    if (mFlash.writeBuffer(mAddr, data, len) != len) return false;
+    mAddr += len;
+    return true;
+  }
+
+private:
+
+  Flash &mFlash;
+  uint32_t mAddr;
+  uint32_t mEnd;
+};
+
+/**
+ * Double buffered logger. The acquisition side adds samples to the active
+ * buffer, e.g. as sink of readn_to or from a timer interrupt. A full
+ * buffer is handed over to the background side, which writes it with
+ * poll() as one aligned block, e.g. from loop(). With a byte limit poll()
+ * writes the block in bounded chunks, e.g. as chunk function of
+ * MCP320xBus::Arbiter. Chunks only stay short if the storage doesn't
+ * block, e.g. a SD card has to be checked for its busy state before.
+ * If the other buffer is still not written when the active one is full,
+ * the active buffer is dropped and counted as overrun.
+ * Samples are stored as native 16 bit values. Both buffers are kept in
+ * RAM, smaller blocks should be used on AVR. The background side and
+ * getStats must not be called from an interrupt, as they briefly
+ * disable interrupts to read values of the acquisition side.
+ * @tparam Storage the storage backend with write(data, len).
+ * @tparam BlockSize the buffer size in bytes, a multiple of 2.
+ */
+template <typename Storage, uint16_t BlockSize = 512>
+class Logger {
+
+public:
+
+  static_assert(BlockSize >= 2 && !(BlockSize & 1),
+    "block size must be a multiple of 2");
+
+  /** Number of samples per block. */
+  static const uint16_t kSamples = BlockSize / 2;
+
+  /**
+   * Defines the logger statistics.
+   */
+  struct Stats {
+    uint32_t blocks;      /**< number of written blocks */
+    uint32_t errors;      /**< number of failed writes */
+    uint32_t overruns;    /**< number of dropped blocks */
+    uint32_t late;        /**< writes slower than the block fill time */
+    uint32_t maxLatency;  /**< longest time from full to written in ns */
+    uint32_t minFill;     /**< shortest block fill time in ns */
+  };
+
+  /**
+   * Initiates a logger.
+   * @param [in] storage the storage backend.
+   */
+  explicit Logger(Storage &storage)
+    : mStorage(storage)
+  {
+    reset();
+  }
+
+  /**
+   * Discards all buffered samples and clears the statistics.
+   */
+  void reset()
+  {
+    MCP320xClock::begin();
+    mActive = 0;
+    mPos = 0;
+    mFull[0] = mFull[1] = false;
+    mWritePos = 0;
+    mStats = {};
+    mFill = UINT32_MAX;
+    mMinFill = UINT32_MAX;
+    mMaxLatency = 0;
+    mStart = MCP320xClock::ticks();
+  }
+
+  /**
+   * Adds the supplied sample.
+   * @param [in] value the sample to add.
+   */
+  void add(uint16_t value)
+  {
+    mBuf[mActive][mPos] = value;
+    if (++mPos == kSamples) swap();
+  }
+
+  /**
+   * Adds the supplied samples.
+   * @param [in] data array of samples.
+   * @param [in] num number of samples.
+   */
+  template <typename T>
+  void add(const T *data, uint16_t num)
+  {
+    for (uint16_t i = 0; i < num; i++) add(static_cast<uint16_t>(data[i]));
+  }
+
+  /**
+   * Adds the supplied sample, allows the use as sink.
+   * @param [in] value the sample to add.
+   */
+  void operator()(uint16_t value)
+  {
+    add(value);
+  }
+
+  /**
+   * Writes the full buffer, if any, or the next chunk of it.
+   * @param [in] maxBytes the maximum number of bytes to write, the rest
+   * of the block by default.
+   * @return true if a chunk was written.
+   */
+  bool poll(uint16_t maxBytes = BlockSize)
+  {
+    uint8_t b = mActive ^ 1;
+    if (!mFull[b] || !maxBytes) return false;
+
+    uint16_t len = BlockSize - mWritePos;
+    if (len > maxBytes) len = maxBytes;
+    const uint8_t *data = reinterpret_cast<const uint8_t *>(mBuf[b]);
+    if (mStorage.write(data + mWritePos, len)) {
+      mWritePos += len;
+      if (mWritePos < BlockSize) return true;
+      mStats.blocks++;
+    } else {
+      // the rest of the block is dropped
+      mStats.errors++;
+    }
+
+    complete(b);
+    mWritePos = 0;
+    mFull[b] = false;
+    return true;
+  }
+
+  /**
+   * Writes all buffered samples, the last block may be partial.
+   * Must not be called while the acquisition is running.
+   * @return true if all writes succeeded.
+   */
+  bool flush()
+  {
+    uint32_t errors = mStats.errors;
+    poll();
+    if (mPos) {
+      const uint8_t *data = reinterpret_cast<const uint8_t *>(mBuf[mActive]);
+      if (mStorage.write(data, mPos * 2)) mStats.blocks++;
+      else mStats.errors++;
+      mPos = 0;
+    }
+    return mStats.errors == errors;
+  }
+
+  /**
+   * Returns the logger statistics.
+   * @return the statistics.
+   */
+  Stats getStats() const
+  {
+    // overruns and fill times are updated by the acquisition side
+    noInterrupts();
+    Stats stats = mStats;
+    uint32_t minFill = mMinFill;
+    interrupts();
+
+    stats.maxLatency = MCP320xClock::toNs(mMaxLatency);
+    stats.minFill = (minFill != UINT32_MAX) ? MCP320xClock::toNs(minFill) : 0;
+    return stats;
+  }
+
+private:
+
+  /**
+   * Hands the active buffer over to the background side.
+   */
+  void swap()
+  {
+    uint32_t now = MCP320xClock::ticks();
+    uint32_t fill = now - mStart;
+    mStart = now;
+    mPos = 0;
+
+    // background still busy, drop the block
+    if (mFull[mActive ^ 1]) {
+      mStats.overruns++;
+      return;
+    }
+
+    if (fill < mMinFill) mMinFill = fill;
+    mFill = fill;
+    mFullAt[mActive] = now;
+    mFull[mActive] = true;
+    mActive ^= 1;
+  }
+
+  /**
+   * Updates the latency statistics of a completed block.
+   * @param [in] b the buffer index.
+   */
+  void complete(uint8_t b)
+  {
+    uint32_t latency = MCP320xClock::ticks() - mFullAt[b];
+    if (latency > mMaxLatency) mMaxLatency = latency;
+
+    // 32 bit reads aren't atomic on AVR
+    noInterrupts();
+    uint32_t fill = mFill;
+    interrupts();
+    if (latency > fill) mStats.late++;
+  }
+
+private:
+
+  Storage &mStorage;
+  alignas(4) uint16_t mBuf[2][kSamples];
+  volatile uint8_t mActive;
+  volatile uint16_t mPos;
+  volatile bool mFull[2];
+  uint16_t mWritePos;
+  uint32_t mFullAt[2];
+  uint32_t mStart;
+  uint32_t mFill;
+  uint32_t mMinFill;
+  uint32_t mMaxLatency;
+  Stats mStats;
+};
+
+}; // namespace MCP320xLog
@@ -0,0 +1,149 @@
+/**
+ * @file Mcp320xMeter.cpp
+ * @author  Patrick Rogalla <patrick@labfruits.com>
+ */
+#include "Mcp320xMeter.h"
+#include "Mcp320xDeskew.h"
+
+namespace MCP320xDsp {
+
+// integer square root
+static uint32_t isqrt(uint64_t v)
+{
+  uint64_t res = 0;
+  uint64_t bit = 1ULL << 62;
+
+  while (bit > v) bit >>= 2;
+  while (bit) {
+    if (v >= res + bit) {
+      v -= res + bit;
+      res = (res >> 1) + bit;
+    } else {
+      res >>= 1;
+    }
+    bit >>= 2;
+  }
+
+  return res;
+}
+
+// rounds a signed Q8 value to an integer
+static int32_t round_q8(int64_t v)
+{
+  return (v >= 0) ? (v + 128) / 256 : (v - 128) / 256;
+}
+
+Meter::Meter(uint8_t vSlot, uint8_t iSlot, uint32_t slotDelay,
+  uint32_t framePeriod, uint16_t hysteresis, uint16_t offset)
+  : mVSlot(vSlot)
+  , mISlot(iSlot)
+  , mHysteresis(hysteresis)
+  , mOffset(offset)
+{
+  // the slot distance delays the later channel
+  uint8_t dist = (iSlot > vSlot) ? iSlot - vSlot : vSlot - iSlot;
+  mPos = skewPosition(dist * slotDelay, framePeriod);
+  mResult = {};
+  reset();
+}
+
+void Meter::reset()
+{
+  mThreshold = 0;
+  mArmed = false;
+  mStarted = false;
+  mFirst = true;
+  mCount = 0;
+  mSumV = mSumI = 0;
+  mSumV2 = mSumI2 = mSumVI = 0;
+}
+
+bool Meter::add(const uint16_t *frame)
+{
+  int16_t v = static_cast<int16_t>(frame[mVSlot] - mOffset);
+  int16_t i = static_cast<int16_t>(frame[mISlot] - mOffset);
+  if (mFirst) {
+    mPrevV = v;
+    mPrevI = i;
+    mFirst = false;
+  }
+
+  // move the later channel back to the sampling instant of the earlier
+  int16_t av = v;
+  int16_t ai = i;
+  if (mISlot > mVSlot) ai = skewAlign(mPrevI, i, mPos);
+  else if (mVSlot > mISlot) av = skewAlign(mPrevV, v, mPos);
+  mPrevV = v;
+  mPrevI = i;
+
+  // rising zero crossing with hysteresis
+  bool done = false;
+  if (!mArmed) {
+    mArmed = (av < mThreshold - mHysteresis);
+  } else if (av > mThreshold + mHysteresis) {
+    mArmed = false;
+    if (mStarted && mCount) {
+      complete();
+      done = true;
+    }
+    mStarted = true;
+    mCount = 0;
+    mSumV = mSumI = 0;
+    mSumV2 = mSumI2 = mSumVI = 0;
+  }
+
+  if (!mStarted) return done;
+
+  // restart on missing crossings
+  if (mCount == UINT16_MAX) {
+    mStarted = false;
+    return done;
+  }
+
+  mCount++;
+  mSumV += av;
+  mSumI += ai;
+  mSumV2 += static_cast<int32_t>(av) * av;
+  mSumI2 += static_cast<int32_t>(ai) * ai;
+  mSumVI += static_cast<int32_t>(av) * ai;
+
+  return done;
+}
+
+const Meter::Result &Meter::result() const
+{
+  return mResult;
+}
+
+void Meter::complete()
+{
+  int64_t n = mCount;
+
+  // mean square values without DC offset in Q8, the exact sums of
+  // squares are divided twice by n to stay within 64 bit
+  int64_t msV = (n * mSumV2 - static_cast<int64_t>(mSumV) * mSumV) / n;
+  int64_t msI = (n * mSumI2 - static_cast<int64_t>(mSumI) * mSumI) / n;
+  int64_t p = (n * mSumVI - static_cast<int64_t>(mSumV) * mSumI) / n;
+  msV = (msV > 0) ? msV * 256 / n : 0;
+  msI = (msI > 0) ? msI * 256 / n : 0;
+  p = p * 256 / n;
+
+  // Q8, real power can't exceed the apparent power
+  uint32_t s = isqrt(static_cast<uint64_t>(msV) * msI);
+  if (p > s) p = s;
+  else if (p < -static_cast<int64_t>(s)) p = -static_cast<int64_t>(s);
+  int64_t q = static_cast<int64_t>(s) * s - p * p;
+
+  mResult.samples = mCount;
+  mResult.vrms = isqrt(msV);
+  mResult.irms = isqrt(msI);
+  mResult.real = round_q8(p);
+  mResult.apparent = round_q8(s);
+  mResult.reactive = (q > 0) ? round_q8(isqrt(q)) : 0;
+  mResult.pf = s ? (p * 32767) / s : 0;
+
+  // track the DC offset for the crossing detection
+  mThreshold = mSumV / n;
+}
+
+}; // namespace MCP320xDsp
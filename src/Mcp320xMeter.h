@@ -0,0 +1,117 @@
+/**
+ * @file Mcp320xMeter.h
+ * @author Patrick Rogalla <patrick@labfruits.com>
+ *
+ * True RMS and power metering stage for MCP320x scan frames.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+namespace MCP320xDsp {
+
+/**
+ * True RMS and power meter for one voltage/current channel pair.
+ * Consumes interleaved scan frames and calculates RMS values, real,
+ * apparent and reactive power and the power factor per line cycle in
+ * fixed point. Cycles are delimited by rising zero crossings of the
+ * voltage. The later converted channel of the pair is interpolated
+ * back to the sampling instant of the earlier one, which corrects the
+ * phase error of sequential sampling. The object can be used as sink
+ * for MCP320x::scan_to.
+ * All values are in ADC units, scaling to volts and amps is left
+ * to the application.
+ */
+class Meter {
+
+public:
+
+  /**
+   * Defines the measurement result of one cycle.
+   */
+  struct Result {
+    uint16_t samples;   /**< number of samples in the cycle */
+    uint32_t vrms;      /**< voltage RMS in 1/16 LSB */
+    uint32_t irms;      /**< current RMS in 1/16 LSB */
+    int32_t real;       /**< real power in LSB² */
+    uint32_t apparent;  /**< apparent power in LSB² */
+    uint32_t reactive;  /**< reactive power (unsigned) in LSB² */
+    int16_t pf;         /**< power factor in Q15 */
+  };
+
+  /**
+   * Initiates a meter.
+   * @param [in] vSlot the voltage channel position in the frame.
+   * @param [in] iSlot the current channel position in the frame.
+   * @param [in] slotDelay delay between two channels in ns, e.g. the
+   * sampling time (see MCP320x::getSplSpeed).
+   * @param [in] framePeriod period of one frame in ns, including the
+   * time spent in the sink between frames, e.g. the measured duration
+   * of a scan divided by the number of frames. The phase is not
+   * corrected if 0.
+   * @param [in] hysteresis zero crossing hysteresis in LSB.
+   * @param [in] offset the initial signal offset, midscale by default.
+   */
+  Meter(uint8_t vSlot, uint8_t iSlot, uint32_t slotDelay,
+    uint32_t framePeriod, uint16_t hysteresis = 16, uint16_t offset = 2048);
+
+  /**
+   * Resets the meter, the next cycle starts with the next
+   * rising zero crossing.
+   */
+  void reset();
+
+  /**
+   * Adds the supplied scan frame.
+   * @param [in] frame array of samples in frame order.
+   * @return true if a cycle was completed and a new result
+   * is available with result().
+   */
+  bool add(const uint16_t *frame);
+
+  /**
+   * Adds the supplied frame, allows the use as sink.
+   * @param [in] frame array of samples in frame order.
+   */
+  void operator()(const uint16_t *frame)
+  {
+    add(frame);
+  }
+
+  /**
+   * Returns the result of the last completed cycle.
+   * @return the measurement result.
+   */
+  const Result &result() const;
+
+private:
+
+  /**
+   * Calculates the result of the current cycle.
+   */
+  void complete();
+
+private:
+
+  uint8_t mVSlot;
+  uint8_t mISlot;
+  uint16_t mPos;
+  int16_t mHysteresis;
+  uint16_t mOffset;
+  int16_t mThreshold;
+  bool mArmed;
+  bool mStarted;
+  bool mFirst;
+  int16_t mPrevV;
+  int16_t mPrevI;
+  uint16_t mCount;
+  int32_t mSumV;
+  int32_t mSumI;
+  int64_t mSumV2;
+  int64_t mSumI2;
+  int64_t mSumVI;
+  Result mResult;
+};
+
+}; // namespace MCP320xDsp
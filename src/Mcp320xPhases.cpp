@@ -0,0 +1,75 @@
+/**
+ * @file Mcp320xPhases.cpp
+ * @author  Patrick Rogalla <patrick@labfruits.com>
+ */
+#include "Mcp320xPhases.h"
+#include "Mcp320xClock.h"
+
+namespace MCP320xProfile {
+
+uint64_t Phases::sTotal[PHASE_COUNT];
+uint32_t Phases::sCount[PHASE_COUNT];
+uint32_t Phases::sLast;
+bool Phases::sActive;
+
+void Phases::reset()
+{
+  for (uint8_t i = 0; i < PHASE_COUNT; i++) {
+    sTotal[i] = 0;
+    sCount[i] = 0;
+  }
+  sActive = false;
+  // enabled once, outside of the measured transfers
+  MCP320xClock::begin();
+}
+
+uint32_t Phases::getCount(Phase p)
+{
+  return sCount[p];
+}
+
+uint64_t Phases::getTotal(Phase p)
+{
+  return MCP320xClock::toNs(sTotal[p]);
+}
+
+uint32_t Phases::getAverage(Phase p)
+{
+  return sCount[p] ? getTotal(p) / sCount[p] : 0;
+}
+
+uint32_t Phases::start()
+{
+  uint32_t t = MCP320xClock::ticks();
+
+  // time since the end of the previous transfer
+  if (sActive) {
+    sTotal[LOOP] += t - sLast;
+    sCount[LOOP]++;
+  }
+
+  return t;
+}
+
+uint32_t Phases::mark(Phase p, uint32_t t)
+{
+  uint32_t now = MCP320xClock::ticks();
+
+  sTotal[p] += now - t;
+  sCount[p]++;
+
+  return now;
+}
+
+void Phases::end(Phase p, uint32_t t)
+{
+  sLast = mark(p, t);
+  sActive = true;
+}
+
+void Phases::stop()
+{
+  sActive = false;
+}
+
+}; // namespace MCP320xProfile
@@ -0,0 +1,121 @@
+/**
+ * @file Mcp320xPhases.h
+ * @author Patrick Rogalla <patrick@labfruits.com>
+ *
+ * Per phase timing breakdown of the MCP320x SPI transfer. The
+ * instrumentation is only compiled in when the library is built with
+ * MCP320X_PROFILE_PHASES defined (e.g. as build flag), otherwise the
+ * hooks are empty and all values stay 0.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#if defined(MCP320X_PROFILE_PHASES)
+#define MCP320X_PHASE_START() \
+  uint32_t mcp320xPhaseT = MCP320xProfile::Phases::start()
+#define MCP320X_PHASE(p) \
+  mcp320xPhaseT = MCP320xProfile::Phases::mark( \
+    MCP320xProfile::Phases::p, mcp320xPhaseT)
+#define MCP320X_PHASE_END(p) \
+  MCP320xProfile::Phases::end(MCP320xProfile::Phases::p, mcp320xPhaseT)
+#define MCP320X_PHASE_STOP() \
+  MCP320xProfile::Phases::stop()
+#else
+#define MCP320X_PHASE_START()
+#define MCP320X_PHASE(p)
+#define MCP320X_PHASE_END(p)
+#define MCP320X_PHASE_STOP()
+#endif
+
+namespace MCP320xProfile {
+
+/**
+ * Aggregated timing of the transfer phases. Every phase is
+ * timestamped with the clock of Mcp320xClock.h, the time of the
+ * timestamp itself is included in the phases.
+ */
+class Phases {
+
+public:
+
+  /**
+   * Defines the measured phases of one conversion.
+   */
+  enum Phase {
+    CS_ASSERT = 0,   /**< chip select activation */
+    TRANSFER_0,      /**< first byte transfer */
+    TRANSFER_1,      /**< second byte transfer */
+    TRANSFER_2,      /**< third byte transfer (not for MCP3201) */
+    CS_DEASSERT,     /**< chip select deactivation */
+    LOOP,            /**< time between two transfers of one read call
+                          (store, loop) */
+    PHASE_COUNT      /**< number of phases */
+  };
+
+  /**
+   * Resets all phase timings and enables the clock. Must be called
+   * before the measurement.
+   */
+  static void reset();
+
+  /**
+   * Returns the number of measurements of the supplied phase.
+   * @param [in] p the phase.
+   * @return the number of measurements.
+   */
+  static uint32_t getCount(Phase p);
+
+  /**
+   * Returns the accumulated time of the supplied phase.
+   * @param [in] p the phase.
+   * @return the time in ns.
+   */
+  static uint64_t getTotal(Phase p);
+
+  /**
+   * Returns the average time of the supplied phase.
+   * @param [in] p the phase.
+   * @return the time in ns.
+   */
+  static uint32_t getAverage(Phase p);
+
+  /**
+   * Starts the measurement of a transfer. Used by the
+   * instrumentation hooks.
+   * @return the start timestamp.
+   */
+  static uint32_t start();
+
+  /**
+   * Completes the supplied phase. Used by the instrumentation hooks.
+   * @param [in] p the completed phase.
+   * @param [in] t the start timestamp of the phase.
+   * @return the end timestamp of the phase.
+   */
+  static uint32_t mark(Phase p, uint32_t t);
+
+  /**
+   * Completes the last phase of a transfer. Used by the
+   * instrumentation hooks.
+   * @param [in] p the completed phase.
+   * @param [in] t the start timestamp of the phase.
+   */
+  static void end(Phase p, uint32_t t);
+
+  /**
+   * Ends a read call, the time until the next transfer is not counted
+   * as loop time. Used by the instrumentation hooks.
+   */
+  static void stop();
+
+private:
+
+  static uint64_t sTotal[PHASE_COUNT];
+  static uint32_t sCount[PHASE_COUNT];
+  static uint32_t sLast;
+  static bool sActive;
+};
+
+}; // namespace MCP320xProfile
@@ -0,0 +1,136 @@
+/**
+ * @file Mcp320xQuantile.cpp
+ * @author  Patrick Rogalla <patrick@labfruits.com>
+ */
+#include "Mcp320xQuantile.h"
+
+namespace MCP320xDsp {
+
+Quantile::Quantile(float p, uint32_t window)
+  : mP(p)
+  , mWindow(window)
+{
+  // desired position increments in Q24, accumulated exactly in fixed
+  // point, float increments stop adding up after 2^24 samples
+  const float one = 1UL << kFracBits;
+  mStep[0] = 0;
+  mStep[1] = static_cast<uint32_t>(mP / 2 * one + 0.5f);
+  mStep[2] = static_cast<uint32_t>(mP * one + 0.5f);
+  mStep[3] = static_cast<uint32_t>((1 + mP) / 2 * one + 0.5f);
+  mStep[4] = 1UL << kFracBits;
+  reset();
+}
+
+void Quantile::reset()
+{
+  mLast = 0;
+  mValid = false;
+  restart();
+}
+
+void Quantile::add(uint16_t value)
+{
+  float x = value;
+
+  // collect the initial marker heights
+  if (mCount < 5) {
+    // insertion sort
+    uint8_t i = mCount++;
+    for (; i > 0 && mHeight[i - 1] > x; i--) mHeight[i] = mHeight[i - 1];
+    mHeight[i] = x;
+  } else {
+    mCount++;
+
+    // find the cell of the sample and adjust the extreme markers
+    uint8_t k;
+    if (x < mHeight[0]) {
+      mHeight[0] = x;
+      k = 0;
+    } else if (x >= mHeight[4]) {
+      mHeight[4] = x;
+      k = 3;
+    } else {
+      for (k = 0; x >= mHeight[k + 1]; k++) {}
+    }
+
+    // increment positions of the markers above the sample
+    for (uint8_t i = k + 1; i < 5; i++) mPos[i]++;
+    // increment desired positions
+    for (uint8_t i = 1; i < 5; i++) {
+      mFraction[i] += mStep[i];
+      mDesired[i] += mFraction[i] >> kFracBits;
+      mFraction[i] &= (1UL << kFracBits) - 1;
+    }
+
+    // adjust the middle markers
+    for (uint8_t i = 1; i < 4; i++) {
+      float d = (mDesired[i] - mPos[i]) +
+        static_cast<float>(mFraction[i]) / (1UL << kFracBits);
+      if ((d >= 1 && mPos[i + 1] - mPos[i] > 1) ||
+          (d <= -1 && mPos[i - 1] - mPos[i] < -1)) {
+        int8_t s = (d >= 0) ? 1 : -1;
+        float h = parabolic(i, s);
+        if (mHeight[i - 1] < h && h < mHeight[i + 1]) mHeight[i] = h;
+        else mHeight[i] = linear(i, s);
+        mPos[i] += s;
+      }
+    }
+  }
+
+  // complete the window
+  if (mWindow && mCount >= mWindow) {
+    mLast = estimate();
+    mValid = true;
+    restart();
+  }
+}
+
+float Quantile::value() const
+{
+  return mValid ? mLast : estimate();
+}
+
+float Quantile::getQuantile() const
+{
+  return mP;
+}
+
+void Quantile::restart()
+{
+  mCount = 0;
+  // desired positions after 5 samples, 4 increments
+  for (uint8_t i = 0; i < 5; i++) {
+    mPos[i] = i;
+    uint32_t q = mStep[i] * 4;
+    mDesired[i] = q >> kFracBits;
+    mFraction[i] = q & ((1UL << kFracBits) - 1);
+  }
+}
+
+float Quantile::estimate() const
+{
+  if (!mCount) return 0;
+  // the initial heights are sorted samples
+  if (mCount < 5) return mHeight[static_cast<uint8_t>(mP * (mCount - 1) + 0.5f)];
+
+  return mHeight[2];
+}
+
+float Quantile::parabolic(uint8_t i, int8_t d) const
+{
+  float q0 = mHeight[i - 1], q1 = mHeight[i], q2 = mHeight[i + 1];
+  // position differences in integer, exact for any sample count
+  float n10 = mPos[i] - mPos[i - 1];
+  float n21 = mPos[i + 1] - mPos[i];
+
+  return q1 + d / (n10 + n21) *
+    ((n10 + d) * (q2 - q1) / n21 + (n21 - d) * (q1 - q0) / n10);
+}
+
+float Quantile::linear(uint8_t i, int8_t d) const
+{
+  return mHeight[i] + d * (mHeight[i + d] - mHeight[i]) /
+    static_cast<float>(mPos[i + d] - mPos[i]);
+}
+
+}; // namespace MCP320xDsp
@@ -0,0 +1,126 @@
+/**
+ * @file Mcp320xQuantile.h
+ * @author Patrick Rogalla <patrick@labfruits.com>
+ *
+ * Streaming quantile estimator for MCP320x sample streams.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+namespace MCP320xDsp {
+
+/**
+ * Streaming quantile estimator for a single channel and quantile,
+ * based on the P² algorithm (Jain/Chlamtac). The estimator uses 5
+ * markers, the memory usage is constant and no samples are stored.
+ * With a window length the estimation restarts every window, and the
+ * estimation of the last completed window is reported. The object can
+ * be used as sink for MCP320x::readn_to.
+ */
+class Quantile {
+
+public:
+
+  /**
+   * Initiates a quantile estimator.
+   * @param [in] p the quantile to estimate (0..1), e.g. 0.95 for p95.
+   * @param [in] window the window length in samples, 0 for an
+   * estimation over all samples since the last reset.
+   */
+  explicit Quantile(float p, uint32_t window = 0);
+
+  /**
+   * Resets the estimator.
+   */
+  void reset();
+
+  /**
+   * Adds the supplied sample.
+   * @param [in] value the sample to add.
+   */
+  void add(uint16_t value);
+
+  /**
+   * Adds the supplied samples.
+   * @param [in] data array of samples to add.
+   * @param [in] num number of samples.
+   */
+  template <typename T>
+  void add(const T *data, uint16_t num)
+  {
+    for (decltype(num) i=0; i < num; i++)
+      add(static_cast<uint16_t>(data[i]));
+  }
+
+  /**
+   * Adds the supplied sample, allows the use as sink.
+   * @param [in] value the sample to add.
+   */
+  void operator()(uint16_t value)
+  {
+    add(value);
+  }
+
+  /**
+   * Returns the estimated quantile. With a window length the estimation
+   * of the last completed window is returned, or the running estimation
+   * until the first window is complete.
+   * @return the estimated quantile, 0 without samples.
+   */
+  float value() const;
+
+  /**
+   * Returns the configured quantile.
+   * @return the quantile (0..1).
+   */
+  float getQuantile() const;
+
+private:
+
+  /**
+   * Restarts the estimation.
+   */
+  void restart();
+
+  /**
+   * Returns the running estimation of the current window.
+   * @return the estimated quantile.
+   */
+  float estimate() const;
+
+  /**
+   * Calculates the piecewise parabolic prediction of a marker height.
+   * @param [in] i the marker index.
+   * @param [in] d the marker move direction.
+   * @return the predicted height.
+   */
+  float parabolic(uint8_t i, int8_t d) const;
+
+  /**
+   * Calculates the linear prediction of a marker height.
+   * @param [in] i the marker index.
+   * @param [in] d the marker move direction.
+   * @return the predicted height.
+   */
+  float linear(uint8_t i, int8_t d) const;
+
+  /** Fraction bits of the desired marker positions. */
+  static const uint8_t kFracBits = 24;
+
+private:
+
+  float mP;
+  uint32_t mWindow;
+  uint32_t mCount;
+  float mLast;
+  bool mValid;
+  float mHeight[5];
+  int32_t mPos[5];
+  int32_t mDesired[5];
+  uint32_t mFraction[5];
+  uint32_t mStep[5];
+};
+
+}; // namespace MCP320xDsp
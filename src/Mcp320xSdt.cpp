@@ -0,0 +1,133 @@
+/**
+ * @file Mcp320xSdt.cpp
+ * @author  Patrick Rogalla <patrick@labfruits.com>
+ */
+#include "Mcp320xSdt.h"
+
+namespace MCP320xDsp {
+
+// divide n by positive d and round towards negative infinity
+static int32_t div_floor(int64_t n, uint32_t d)
+{
+  return (n >= 0) ? n / d : -((-n + d - 1) / d);
+}
+
+// divide n by positive d and round towards positive infinity
+static int32_t div_ceil(int64_t n, uint32_t d)
+{
+  return (n >= 0) ? (n + d - 1) / d : -(-n / d);
+}
+
+Sdt::Sdt(uint16_t maxDev)
+  : mMaxDev(maxDev)
+{
+  reset();
+}
+
+void Sdt::reset()
+{
+  mIndex = 0;
+  mStarted = false;
+  mOpen = false;
+}
+
+bool Sdt::add(uint16_t value)
+{
+  Point p = { mIndex++, value };
+
+  // the first sample always starts a segment
+  if (!mStarted) {
+    mStarted = true;
+    mArchive = p;
+    mPoint = p;
+    return true;
+  }
+
+  if (!mOpen) {
+    open(p);
+    return false;
+  }
+
+  // door slopes through the tolerance band of the new sample
+  uint32_t dt = p.index - mArchive.index;
+  int32_t dv = static_cast<int32_t>(p.value) - mArchive.value;
+  Slope upper = { dv + mMaxDev, dt };
+  Slope lower = { dv - mMaxDev, dt };
+  // endpoints can't be negative
+  Slope zero = { -static_cast<int32_t>(mArchive.value), dt };
+  if (less(lower, zero)) lower = zero;
+
+  // narrow the door
+  if (less(mUpper, upper)) upper = mUpper;
+  if (less(lower, mLower)) lower = mLower;
+
+  // door closed, the previous sample ends the segment
+  if (less(upper, lower)) {
+    emit();
+    open(p);
+    return true;
+  }
+
+  mUpper = upper;
+  mLower = lower;
+  mLast = p;
+  return false;
+}
+
+bool Sdt::flush()
+{
+  if (!mOpen) return false;
+
+  emit();
+  return true;
+}
+
+const Sdt::Point &Sdt::point() const
+{
+  return mPoint;
+}
+
+uint16_t Sdt::getMaxDev() const
+{
+  return mMaxDev;
+}
+
+bool Sdt::less(const Slope &a, const Slope &b)
+{
+  return static_cast<int64_t>(a.num) * b.den <
+    static_cast<int64_t>(b.num) * a.den;
+}
+
+void Sdt::open(const Point &p)
+{
+  uint32_t dt = p.index - mArchive.index;
+  int32_t dv = static_cast<int32_t>(p.value) - mArchive.value;
+
+  mUpper = { dv + mMaxDev, dt };
+  mLower = { dv - mMaxDev, dt };
+  // endpoints can't be negative, the sample itself is always inside
+  if (mLower.num < -static_cast<int32_t>(mArchive.value))
+    mLower.num = -static_cast<int32_t>(mArchive.value);
+  mLast = p;
+  mOpen = true;
+}
+
+void Sdt::emit()
+{
+  uint32_t dt = mLast.index - mArchive.index;
+  int32_t dv = static_cast<int32_t>(mLast.value) - mArchive.value;
+
+  // keep the endpoint inside the door, so the segment stays within
+  // the deviation limit for all covered samples
+  int32_t lo = div_ceil(static_cast<int64_t>(mLower.num) * dt, mLower.den);
+  int32_t up = div_floor(static_cast<int64_t>(mUpper.num) * dt, mUpper.den);
+  if (dv < lo) dv = lo;
+  else if (dv > up) dv = up;
+
+  mPoint.index = mLast.index;
+  mPoint.value = static_cast<uint16_t>(mArchive.value + dv);
+  mArchive = mPoint;
+  mOpen = false;
+}
+
+}; // namespace MCP320xDsp
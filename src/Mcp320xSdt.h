@@ -0,0 +1,133 @@
+/**
+ * @file Mcp320xSdt.h
+ * @author Patrick Rogalla <patrick@labfruits.com>
+ *
+ * Swinging door trending (SDT) compression for MCP320x sample streams.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+namespace MCP320xDsp {
+
+/**
+ * Swinging door trending compressor for a single channel. Samples are
+ * consumed one by one and only the segment endpoints are emitted. The
+ * linear interpolation between two consecutive endpoints deviates at
+ * most by the configured maximum deviation (plus 1 LSB of rounding)
+ * from every sample in between. The memory usage is constant.
+ * One instance is required per channel.
+ */
+class Sdt {
+
+public:
+
+  /**
+   * Defines a segment endpoint.
+   */
+  struct Point {
+    uint32_t index;  /**< sample index since the last reset */
+    uint16_t value;  /**< sample value */
+  };
+
+  /**
+   * Initiates a SDT compressor.
+   * @param [in] maxDev the maximum allowed deviation in LSB.
+   */
+  explicit Sdt(uint16_t maxDev);
+
+  /**
+   * Resets the compressor. The next sample starts a new trend
+   * at sample index 0.
+   */
+  void reset();
+
+  /**
+   * Adds the supplied sample to the trend.
+   * @param [in] value the sample to add.
+   * @return true if a segment endpoint was emitted, which is then
+   * available with point().
+   */
+  bool add(uint16_t value);
+
+  /**
+   * Adds the supplied samples to the trend and stores all emitted
+   * segment endpoints in the supplied array.
+   * @param [in] data array of samples to add.
+   * @param [in] num number of samples.
+   * @param [out] out array to store the endpoints. The array needs to
+   * be at least num in size.
+   * @return the number of stored endpoints.
+   */
+  template <typename T>
+  uint16_t add(const T *data, uint16_t num, Point *out)
+  {
+    uint16_t cnt = 0;
+    for (decltype(num) i=0; i < num; i++)
+      if (add(static_cast<uint16_t>(data[i]))) out[cnt++] = mPoint;
+    return cnt;
+  }
+
+  /**
+   * Closes the current segment and emits the last sample as endpoint.
+   * Should be called at the end of a stream.
+   * @return true if a segment endpoint was emitted, which is then
+   * available with point().
+   */
+  bool flush();
+
+  /**
+   * Returns the last emitted segment endpoint.
+   * @return the segment endpoint.
+   */
+  const Point &point() const;
+
+  /**
+   * Returns the configured maximum deviation.
+   * @return the maximum deviation in LSB.
+   */
+  uint16_t getMaxDev() const;
+
+private:
+
+  /**
+   * Defines a slope as fraction of a value difference
+   * and an index difference.
+   */
+  struct Slope {
+    int32_t num;   /**< value difference */
+    uint32_t den;  /**< index difference */
+  };
+
+  /**
+   * Compares two slopes.
+   * @return true if slope a is less than slope b.
+   */
+  static bool less(const Slope &a, const Slope &b);
+
+  /**
+   * Opens the door from the archived point to the supplied point.
+   * @param [in] p the point to open the door with.
+   */
+  void open(const Point &p);
+
+  /**
+   * Emits the pending point as segment endpoint and archives it.
+   */
+  void emit();
+
+private:
+
+  uint16_t mMaxDev;
+  uint32_t mIndex;
+  bool mStarted;
+  bool mOpen;
+  Point mArchive;
+  Point mLast;
+  Point mPoint;
+  Slope mUpper;
+  Slope mLower;
+};
+
+}; // namespace MCP320xDsp
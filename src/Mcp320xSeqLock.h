@@ -0,0 +1,22 @@
+/**
+ * @file Mcp320xSeqLock.h
+ * @author Patrick Rogalla <patrick@labfruits.com>
+ *
+ * Sequence lock for consistent snapshots of data, which is updated
+ * in the acquisition path and read from another core or task. Readers
+ * in an interrupt, which preempts the writer, need bounded retries.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Memory barrier used by the sequence lock. AVR has a single core,
+ * a compiler barrier is sufficient.
+ */
+#if defined(__AVR__)
+#define MCP320X_BARRIER() __asm__ __volatile__("" ::: "memory")
+#else
+#define MCP320X_BARRIER() __sync_synchronize()
+#endif
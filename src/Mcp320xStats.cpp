@@ -0,0 +1,77 @@
+/**
+ * @file Mcp320xStats.cpp
+ * @author  Patrick Rogalla <patrick@labfruits.com>
+ */
+#include <math.h>
+#include "Mcp320xStats.h"
+
+namespace MCP320xDsp {
+
+Stats::Stats()
+  : mSeq(0)
+{
+  reset();
+}
+
+void Stats::reset()
+{
+  begin();
+  mState = {};
+  mState.min = UINT16_MAX;
+  end();
+}
+
+Stats::Snapshot Stats::snapshot() const
+{
+  State s;
+  load(s, 0);
+  return evaluate(s);
+}
+
+bool Stats::trySnapshot(Snapshot &snap, uint8_t tries) const
+{
+  State s;
+  if (!load(s, tries ? tries : 1)) return false;
+  snap = evaluate(s);
+  return true;
+}
+
+bool Stats::load(State &s, uint8_t tries) const
+{
+  // copy the state until no write section overlapped
+  for (;;) {
+    uint32_t seq = mSeq;
+    MCP320X_BARRIER();
+    s = mState;
+    MCP320X_BARRIER();
+    if (!(seq & 1) && seq == mSeq) return true;
+    if (tries && !--tries) return false;
+  }
+}
+
+Stats::Snapshot Stats::evaluate(const State &s)
+{
+  Snapshot snap = {};
+  if (!s.count) return snap;
+
+  snap.count = s.count;
+  snap.min = s.min;
+  snap.max = s.max;
+#if MCP320X_STATS_INTEGER
+  // sum of squared deviations, exact up to the integer division
+  uint64_t sq = s.sumSq -
+    (static_cast<uint64_t>(s.sum) * s.sum) / s.count;
+  snap.mean = static_cast<float>(s.sum) / s.count;
+  snap.variance = static_cast<float>(sq) / s.count;
+  snap.rms = sqrtf(static_cast<float>(s.sumSq) / s.count);
+#else
+  double var = s.m2 / s.count;
+  snap.mean = s.mean;
+  snap.variance = var;
+  snap.rms = sqrt(var + s.mean * s.mean);
+#endif
+
+  return snap;
+}
+
+}; // namespace MCP320xDsp
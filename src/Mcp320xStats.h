@@ -0,0 +1,186 @@
+/**
+ * @file Mcp320xStats.h
+ * @author Patrick Rogalla <patrick@labfruits.com>
+ *
+ * Streaming statistics accumulator for MCP320x sample streams.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "Mcp320xSeqLock.h"
+
+/*
+ * Welford's algorithm needs double precision, which is emulated in
+ * software on most MCUs. Hosts and MCUs with a double precision FPU
+ * use Welford's algorithm, all other targets accumulate integer sums.
+ * Define MCP320X_STATS_INTEGER to 0 or 1 to override.
+ */
+#ifndef MCP320X_STATS_INTEGER
+#if !defined(ARDUINO) || (defined(__ARM_FP) && (__ARM_FP & 8))
+#define MCP320X_STATS_INTEGER 0
+#else
+#define MCP320X_STATS_INTEGER 1
+#endif
+#endif
+
+namespace MCP320xDsp {
+
+/**
+ * Streaming statistics accumulator for a single channel. Calculates
+ * mean, variance, min, max and RMS while sampling, without storing
+ * the samples. The object can be used as sink for MCP320x::readn_to.
+ * A consistent snapshot can be taken from another core or task while
+ * the accumulator is updated (sequence lock). An interrupt, which can
+ * preempt the writer on the same core, must use trySnapshot, as the
+ * interrupted write section never ends while the reader spins.
+ * With integer accumulation at most 2^20 samples should be
+ * accumulated between resets.
+ */
+class Stats {
+
+public:
+
+  /**
+   * Defines a consistent snapshot of the statistics.
+   */
+  struct Snapshot {
+    uint32_t count;  /**< number of samples */
+    uint16_t min;    /**< minimum sample value */
+    uint16_t max;    /**< maximum sample value */
+    float mean;      /**< arithmetic mean */
+    float variance;  /**< population variance */
+    float rms;       /**< root mean square */
+  };
+
+  /**
+   * Initiates an empty accumulator.
+   */
+  Stats();
+
+  /**
+   * Resets the accumulator.
+   */
+  void reset();
+
+  /**
+   * Adds the supplied sample.
+   * @param [in] value the sample to add.
+   */
+  void add(uint16_t value)
+  {
+    begin();
+    State &s = mState;
+    s.count++;
+    if (value < s.min) s.min = value;
+    if (value > s.max) s.max = value;
+#if MCP320X_STATS_INTEGER
+    s.sum += value;
+    s.sumSq += static_cast<uint32_t>(value) * value;
+#else
+    double delta = value - s.mean;
+    s.mean += delta / s.count;
+    s.m2 += delta * (value - s.mean);
+#endif
+    end();
+  }
+
+  /**
+   * Adds the supplied samples.
+   * @param [in] data array of samples to add.
+   * @param [in] num number of samples.
+   */
+  template <typename T>
+  void add(const T *data, uint16_t num)
+  {
+    for (decltype(num) i=0; i < num; i++)
+      add(static_cast<uint16_t>(data[i]));
+  }
+
+  /**
+   * Adds the supplied sample, allows the use as sink.
+   * @param [in] value the sample to add.
+   */
+  void operator()(uint16_t value)
+  {
+    add(value);
+  }
+
+  /**
+   * Takes a consistent snapshot of the current statistics. Safe to
+   * call from another core or task while samples are added, spins
+   * until no write section overlaps. Must not be called from an
+   * interrupt, which preempts the writer.
+   * @return the statistics, all values are 0 without samples.
+   */
+  Snapshot snapshot() const;
+
+  /**
+   * Tries to take a consistent snapshot of the current statistics with
+   * a bounded number of attempts. Safe to call from an interrupt, which
+   * preempts the writer.
+   * @param [out] snap the statistics, all values are 0 without samples.
+   * @param [in] tries maximum number of attempts, at least 1.
+   * @return true if the snapshot is consistent, false if a write
+   * section overlapped every attempt.
+   */
+  bool trySnapshot(Snapshot &snap, uint8_t tries = 4) const;
+
+private:
+
+  /**
+   * Defines the accumulator state.
+   */
+  struct State {
+    uint32_t count;
+    uint16_t min;
+    uint16_t max;
+#if MCP320X_STATS_INTEGER
+    uint32_t sum;
+    uint64_t sumSq;
+#else
+    double mean;
+    double m2;
+#endif
+  };
+
+  /**
+   * Copies the state consistently.
+   * @param [out] s the copied state.
+   * @param [in] tries maximum number of attempts, 0 for no limit.
+   * @return true if no write section overlapped the copy.
+   */
+  bool load(State &s, uint8_t tries) const;
+
+  /**
+   * Calculates the statistics of the supplied state.
+   * @param [in] s the accumulator state.
+   * @return the statistics.
+   */
+  static Snapshot evaluate(const State &s);
+
+  /**
+   * Starts a write section of the sequence lock.
+   */
+  void begin()
+  {
+    mSeq = mSeq + 1;
+    MCP320X_BARRIER();
+  }
+
+  /**
+   * Ends a write section of the sequence lock.
+   */
+  void end()
+  {
+    MCP320X_BARRIER();
+    mSeq = mSeq + 1;
+  }
+
+private:
+
+  volatile uint32_t mSeq;
+  State mState;
+};
+
+}; // namespace MCP320xDsp
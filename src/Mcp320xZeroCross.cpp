@@ -0,0 +1,64 @@
+/**
+ * @file Mcp320xZeroCross.cpp
+ * @author  Patrick Rogalla <patrick@labfruits.com>
+ */
+#include "Mcp320xZeroCross.h"
+
+namespace MCP320xDsp {
+
+ZeroCross::ZeroCross(uint32_t splFreq, uint16_t hysteresis, uint16_t offset)
+  : mSplFreq(splFreq)
+  , mHysteresis(hysteresis)
+  , mOffset(offset)
+{
+  reset();
+}
+
+void ZeroCross::reset()
+{
+  mArmed = false;
+  mStarted = false;
+  mPrev = 0;
+  mIndex = 0;
+  mLast = 0;
+  mPeriod = 0;
+}
+
+uint32_t ZeroCross::getPeriod() const
+{
+  if (!mPeriod) return 0;
+  return (static_cast<uint64_t>(mPeriod) * 1000000000UL + (mSplFreq << 7)) /
+    (static_cast<uint64_t>(mSplFreq) << 8);
+}
+
+uint32_t ZeroCross::getFrequency() const
+{
+  if (!mPeriod) return 0;
+  return (static_cast<uint64_t>(mSplFreq) * 256000UL + (mPeriod >> 1)) /
+    mPeriod;
+}
+
+uint32_t ZeroCross::getPeriodSamples() const
+{
+  return mPeriod;
+}
+
+bool ZeroCross::crossing(int16_t x)
+{
+  mArmed = false;
+
+  // sub-sample position of the crossing between previous and
+  // current sample in 1/256 samples
+  int32_t span = x - mPrev;
+  uint32_t frac = span ? (static_cast<int32_t>(-mPrev) << 8) / span : 0;
+  uint32_t t = ((mIndex - 1) << 8) + frac;
+
+  bool valid = mStarted;
+  if (valid) mPeriod = t - mLast;
+  mLast = t;
+  mStarted = true;
+
+  return valid;
+}
+
+}; // namespace MCP320xDsp
@@ -0,0 +1,108 @@
+/**
+ * @file Mcp320xZeroCross.h
+ * @author Patrick Rogalla <patrick@labfruits.com>
+ *
+ * Zero crossing frequency and period measurement for MCP320x
+ * sample streams.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+namespace MCP320xDsp {
+
+/**
+ * Measures period and frequency of a signal from its rising zero
+ * crossings. The detector uses a hysteresis against noise, and the
+ * crossing instant is linearly interpolated between two samples with
+ * 1/256 sample resolution. The per sample cost is a comparison, the
+ * estimation is only updated on crossings. The object can be used as
+ * sink for MCP320x::readn_to.
+ */
+class ZeroCross {
+
+public:
+
+  /**
+   * Initiates a zero crossing detector.
+   * @param [in] splFreq the sample frequency in hz.
+   * @param [in] hysteresis the crossing hysteresis in LSB.
+   * @param [in] offset the zero level, midscale by default.
+   */
+  ZeroCross(uint32_t splFreq, uint16_t hysteresis = 16,
+    uint16_t offset = 2048);
+
+  /**
+   * Resets the detector.
+   */
+  void reset();
+
+  /**
+   * Adds the supplied sample.
+   * @param [in] value the sample to add.
+   * @return true on a crossing which updated the estimation.
+   */
+  bool add(uint16_t value)
+  {
+    int16_t x = static_cast<int16_t>(value - mOffset);
+    bool cross = false;
+
+    if (!mArmed) mArmed = (x < -mHysteresis);
+    else if (x >= 0) cross = crossing(x);
+
+    mPrev = x;
+    mIndex++;
+    return cross;
+  }
+
+  /**
+   * Adds the supplied sample, allows the use as sink.
+   * @param [in] value the sample to add.
+   */
+  void operator()(uint16_t value)
+  {
+    add(value);
+  }
+
+  /**
+   * Returns the last measured period.
+   * @return the period in ns, 0 without measurement.
+   */
+  uint32_t getPeriod() const;
+
+  /**
+   * Returns the last measured frequency.
+   * @return the frequency in mHz, 0 without measurement.
+   */
+  uint32_t getFrequency() const;
+
+  /**
+   * Returns the last measured period in samples.
+   * @return the period in 1/256 samples, 0 without measurement.
+   */
+  uint32_t getPeriodSamples() const;
+
+private:
+
+  /**
+   * Handles a rising crossing.
+   * @param [in] x the first sample at or above the zero level.
+   * @return true if the estimation was updated.
+   */
+  bool crossing(int16_t x);
+
+private:
+
+  uint32_t mSplFreq;
+  int16_t mHysteresis;
+  uint16_t mOffset;
+  bool mArmed;
+  bool mStarted;
+  int16_t mPrev;
+  uint32_t mIndex;
+  uint32_t mLast;
+  uint32_t mPeriod;
+};
+
+}; // namespace MCP320xDsp